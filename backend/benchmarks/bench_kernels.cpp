@@ -0,0 +1,92 @@
+#include "kernels/set_ops.hpp"
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace kernels;
+
+// Microbenchmark of the sorted-list kernels over a range of size ratios.
+// Prints nanoseconds per input value for the merge kernel of every supported
+// instruction set, with galloping disabled, and once for the galloping kernel,
+// which has no SIMD variant. A * marks the kernel the default dispatch picks
+// for each operation on this CPU; default_gallop_ratio() is tuned from these
+// tables, so the marked cell should be the fastest one of its ratio.
+
+static vector<uint32_t> random_list(mt19937 &rng, size_t size, uint32_t universe)
+{
+    set<uint32_t> values;
+    uniform_int_distribution<uint32_t> pick(0, universe);
+    while (values.size() < size)
+        values.insert(pick(rng));
+    return vector<uint32_t>(values.begin(), values.end());
+}
+
+// Keeps the kernel results observable so the calls are not optimized away.
+static volatile size_t sink;
+
+static double time_ns(const function<size_t()> &run, size_t values)
+{
+    int repetitions = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::nanoseconds elapsed{};
+    do
+    {
+        sink = run();
+        repetitions++;
+        elapsed = chrono::steady_clock::now() - start;
+    } while (elapsed < chrono::milliseconds(50));
+    return static_cast<double>(elapsed.count()) / repetitions / static_cast<double>(values);
+}
+
+int main()
+{
+    const size_t large_size = 1 << 18;
+    const uint32_t universe = large_size * 4;
+    mt19937 rng(42);
+    vector<uint32_t> large = random_list(rng, large_size, universe);
+    vector<uint32_t> out(2 * large_size);
+
+    vector<Isa> isas;
+    for (Isa isa : {Isa::scalar, Isa::sse41, Isa::avx2})
+        if (supports(isa))
+            isas.push_back(isa);
+
+    cout << format("{:>8} {:>10} {:>8} {:>13} {:>13} {:>13}", "ratio", "small", "kernel", "intersect", "unite",
+                   "difference")
+         << endl;
+    for (size_t ratio : {1, 2, 4, 8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 1024})
+    {
+        vector<uint32_t> small = random_list(rng, large_size / ratio, universe);
+        size_t values = large.size() + small.size();
+        auto row = [&](const string &kernel, Isa isa, size_t gallop_ratio)
+        {
+            bool gallops = gallop_ratio == 1;
+            auto marker = [&](SetOp op)
+            {
+                bool default_gallops = large.size() / small.size() >= default_gallop_ratio(op, best_isa());
+                return gallops == default_gallops && (gallops || isa == best_isa()) ? "*" : " ";
+            };
+            double intersect_ns = time_ns([&]
+                                          { return intersect(large, small, out.data(), isa, gallop_ratio); }, values);
+            double unite_ns = time_ns([&]
+                                      { return unite(large, small, out.data(), isa, gallop_ratio); }, values);
+            double difference_ns = time_ns([&]
+                                           { return difference(large, small, out.data(), isa, gallop_ratio); }, values);
+            cout << format("{:>8} {:>10} {:>8} {:>12.3f}{} {:>12.3f}{} {:>12.3f}{}", ratio, small.size(), kernel,
+                           intersect_ns, marker(SetOp::intersect), unite_ns, marker(SetOp::unite), difference_ns,
+                           marker(SetOp::difference))
+                 << endl;
+        };
+        for (Isa isa : isas)
+            row(isa_name(isa), isa, SIZE_MAX);
+        row("gallop", Isa::scalar, 1);
+    }
+    return 0;
+}
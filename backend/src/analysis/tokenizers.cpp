@@ -206,7 +206,59 @@ namespace analysis
       }
     }
   }
+  // Word scanner
+  static bool is_word_char(unsigned char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '*';
+  };
+  bool supports_word_scanner(const TokenizerConfig &config)
+  {
+    return config.tokenize && !config.gaps && config.pattern == TokenizerConfig().pattern;
+  };
+  vector<Token> scan_words(const TokenizerConfig &config)
+  {
+    if (!supports_word_scanner(config))
+      throw invalid_argument(format("scan_words does not support pattern \"{}\" with tokenize={}, gaps={}",
+                                    config.pattern, config.tokenize, config.gaps));
+    vector<Token> tokens;
+    if (config.text == nullptr)
+      return tokens;
+
+    // [\w\*]+(\.?[\w\*]+)*: runs of word characters joined by single dots.
+    const string &text = *config.text;
+    size_t i = 0;
+    int pos = -1;
+    while (i < text.size())
+    {
+      if (!is_word_char(text[i]))
+      {
+        i++;
+        continue;
+      }
+      size_t start = i;
+      while (i < text.size() && is_word_char(text[i]))
+        i++;
+      while (i + 1 < text.size() && text[i] == '.' && is_word_char(text[i + 1]))
+      {
+        i++;
+        while (i < text.size() && is_word_char(text[i]))
+          i++;
+      }
 
+      Token &token = tokens.emplace_back(config.chars, config.positions, false, config.remove_stops, 1.0, 0);
+      token.text = text.substr(start, i - start);
+      if (config.keep_original)
+        token.original = text;
+      if (config.positions)
+        token.pos = ++pos;
+      if (config.chars)
+      {
+        token.start_char = config.start_char + static_cast<int>(start);
+        token.end_char = config.start_char + static_cast<int>(i);
+      }
+    }
+    return tokens;
+  };
 }
 
 // bool operator==(const Token &left, const Token &right) { return left.text == right.text; };
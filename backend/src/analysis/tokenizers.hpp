@@ -84,5 +84,12 @@ namespace analysis
     bool operator==(const PathTokenizer &other) const;
     void handle_current_token();
   };
+
+  // Hand-written scanner for the default pattern that avoids std::regex. It
+  // must produce exactly the tokens RegexTokenizer produces for the configs it
+  // supports (default pattern, tokenize = true, gaps = false); equivalence is
+  // checked by the differential tests in tests/.
+  bool supports_word_scanner(const TokenizerConfig &config);
+  vector<Token> scan_words(const TokenizerConfig &config);
 }
 #endif
\ No newline at end of file
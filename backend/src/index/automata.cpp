@@ -0,0 +1,76 @@
+#include "automata.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  // LevenshteinAutomaton
+  LevenshteinAutomaton::LevenshteinAutomaton(string term, int max_edits) : term(term), max_edits(max_edits)
+  {
+    if (max_edits < 0)
+      throw invalid_argument("max_edits must not be negative");
+  };
+  LevenshteinAutomaton::State LevenshteinAutomaton::start() const
+  {
+    State row(term.size() + 1);
+    for (size_t j = 0; j < row.size(); j++)
+      row[j] = min(static_cast<int>(j), max_edits + 1);
+    return row;
+  };
+  LevenshteinAutomaton::State LevenshteinAutomaton::step(const State &state, unsigned char c) const
+  {
+    State row(state.size());
+    row[0] = min(state[0] + 1, max_edits + 1);
+    for (size_t j = 1; j < row.size(); j++)
+    {
+      int cost = static_cast<unsigned char>(term[j - 1]) == c ? 0 : 1;
+      row[j] = min({state[j - 1] + cost, state[j] + 1, row[j - 1] + 1, max_edits + 1});
+    }
+    return row;
+  };
+  bool LevenshteinAutomaton::is_match(const State &state) const { return state.back() <= max_edits; };
+  bool LevenshteinAutomaton::can_match(const State &state) const
+  {
+    return *min_element(state.begin(), state.end()) <= max_edits;
+  };
+
+  // WildcardAutomaton
+  WildcardAutomaton::WildcardAutomaton(string pattern) : pattern(pattern) {};
+  void WildcardAutomaton::close(State &state) const
+  {
+    for (size_t i = 0; i < pattern.size(); i++)
+      if (state[i] && pattern[i] == '*')
+        state[i + 1] = true;
+  };
+  WildcardAutomaton::State WildcardAutomaton::start() const
+  {
+    State state(pattern.size() + 1, false);
+    state[0] = true;
+    close(state);
+    return state;
+  };
+  WildcardAutomaton::State WildcardAutomaton::step(const State &state, unsigned char c) const
+  {
+    State next(state.size(), false);
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+      if (!state[i])
+        continue;
+      if (pattern[i] == '*')
+        next[i] = true;
+      else if (static_cast<unsigned char>(pattern[i]) == c)
+        next[i + 1] = true;
+    }
+    close(next);
+    return next;
+  };
+  bool WildcardAutomaton::is_match(const State &state) const { return state.back(); };
+  bool WildcardAutomaton::can_match(const State &state) const
+  {
+    return find(state.begin(), state.end(), true) != state.end();
+  };
+}
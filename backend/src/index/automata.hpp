@@ -0,0 +1,57 @@
+#ifndef AUTOMATA_HPP
+#define AUTOMATA_HPP
+#pragma once
+#include <string>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  // Automata walked over a sorted term dictionary one byte at a time. Every
+  // automaton exposes the same interface so TermDictionary::intersect can
+  // prune whole subranges of terms as soon as a shared prefix goes dead:
+  //   State start() const;
+  //   State step(const State &state, unsigned char c) const;
+  //   bool is_match(const State &state) const;
+  //   bool can_match(const State &state) const;
+
+  // Accepts every string within `max_edits` byte-level Levenshtein edits of
+  // `term`. The state is the current row of the edit-distance matrix capped at
+  // max_edits + 1, which is the lazily-built equivalent of the DFA.
+  class LevenshteinAutomaton
+  {
+  public:
+    using State = vector<int>;
+
+    string term;
+    int max_edits;
+
+    LevenshteinAutomaton(string term, int max_edits);
+    State start() const;
+    State step(const State &state, unsigned char c) const;
+    bool is_match(const State &state) const;
+    bool can_match(const State &state) const;
+  };
+
+  // Accepts strings matching `pattern`, where `*` stands for any (possibly
+  // empty) sequence of bytes and every other byte matches itself. The state is
+  // the set of live pattern positions.
+  class WildcardAutomaton
+  {
+  public:
+    using State = vector<bool>;
+
+    string pattern;
+
+    WildcardAutomaton(string pattern);
+    State start() const;
+    State step(const State &state, unsigned char c) const;
+    bool is_match(const State &state) const;
+    bool can_match(const State &state) const;
+
+  private:
+    void close(State &state) const;
+  };
+}
+#endif
@@ -0,0 +1,115 @@
+#include "stats.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+
+namespace indexing
+{
+  using namespace std;
+
+  string memory_category_name(MemoryCategory category)
+  {
+    switch (category)
+    {
+    case MemoryCategory::tokens:
+      return "tokens";
+    case MemoryCategory::terms:
+      return "terms";
+    case MemoryCategory::postings:
+      return "postings";
+    case MemoryCategory::stored_fields:
+      return "stored_fields";
+    case MemoryCategory::statistics:
+      return "statistics";
+    case MemoryCategory::segments:
+      return "segments";
+    default:
+      return "unknown";
+    }
+  };
+
+  size_t heap_bytes(const string &value)
+  {
+    const char *inline_begin = reinterpret_cast<const char *>(&value);
+    const char *inline_end = inline_begin + sizeof(value);
+    bool is_inline = value.data() >= inline_begin && value.data() < inline_end;
+    return is_inline ? 0 : value.capacity() + 1;
+  };
+  size_t memory_usage(const Token &token)
+  {
+    return sizeof(Token) + heap_bytes(token.text) + heap_bytes(token.original) + heap_bytes(token.mode);
+  };
+
+  // MemorySnapshot
+  size_t MemorySnapshot::operator[](MemoryCategory category) const { return bytes[static_cast<size_t>(category)]; };
+  size_t MemorySnapshot::total() const { return accumulate(bytes.begin(), bytes.end(), size_t(0)); };
+  MemorySnapshot &MemorySnapshot::operator+=(const MemorySnapshot &other)
+  {
+    for (size_t i = 0; i < bytes.size(); i++)
+      bytes[i] += other.bytes[i];
+    return *this;
+  };
+  MemorySnapshot::operator string() const
+  {
+    string s;
+    for (size_t i = 0; i < bytes.size(); i++)
+      s += format("{}={}, ", memory_category_name(static_cast<MemoryCategory>(i)), bytes[i]);
+    return format("MemorySnapshot({}total={})", s, total());
+  };
+
+  // MemoryAccountant
+  void MemoryAccountant::add(MemoryCategory category, int64_t delta)
+  {
+    counters[static_cast<size_t>(category)].fetch_add(delta, memory_order_relaxed);
+  };
+  size_t MemoryAccountant::bytes(MemoryCategory category) const
+  {
+    int64_t value = counters[static_cast<size_t>(category)].load(memory_order_relaxed);
+    return value > 0 ? static_cast<size_t>(value) : 0;
+  };
+  size_t MemoryAccountant::total() const { return snapshot().total(); };
+  MemorySnapshot MemoryAccountant::snapshot() const
+  {
+    MemorySnapshot snapshot;
+    for (size_t i = 0; i < snapshot.bytes.size(); i++)
+      snapshot.bytes[i] = bytes(static_cast<MemoryCategory>(i));
+    return snapshot;
+  };
+
+  // TermStatistics
+  void TermStatistics::begin_document() { doc_count++; };
+  bool TermStatistics::add(const string &text)
+  {
+    auto [it, inserted] = terms.try_emplace(text);
+    TermStats &stats = it->second;
+    if (stats.last_doc != doc_count)
+    {
+      stats.last_doc = doc_count;
+      stats.doc_freq++;
+    }
+    stats.total_freq++;
+    token_count++;
+    if (inserted)
+      bytes += sizeof(decltype(terms)::value_type) + 2 * sizeof(void *) + heap_bytes(it->first);
+    return inserted;
+  };
+  bool TermStatistics::add(const Token &token) { return add(token.text); };
+  uint32_t TermStatistics::documents() const { return doc_count; };
+  uint64_t TermStatistics::tokens() const { return token_count; };
+  size_t TermStatistics::unique_terms() const { return terms.size(); };
+  uint32_t TermStatistics::doc_freq(const string &text) const
+  {
+    auto it = terms.find(text);
+    return it == terms.end() ? 0 : it->second.doc_freq;
+  };
+  uint64_t TermStatistics::total_freq(const string &text) const
+  {
+    auto it = terms.find(text);
+    return it == terms.end() ? 0 : it->second.total_freq;
+  };
+  size_t TermStatistics::memory_usage() const { return bytes + terms.bucket_count() * sizeof(void *); };
+}
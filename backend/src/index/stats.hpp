@@ -0,0 +1,93 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+#pragma once
+#include "analysis/core.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace indexing
+{
+  using namespace std;
+
+  enum class MemoryCategory
+  {
+    tokens,
+    terms,
+    postings,
+    stored_fields,
+    statistics,
+    segments,
+    count
+  };
+
+  constexpr size_t MEMORY_CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::count);
+
+  string memory_category_name(MemoryCategory category);
+
+  // Point-in-time copy of an accountant's counters, safe to export or sum
+  // across writers.
+  struct MemorySnapshot
+  {
+    array<size_t, MEMORY_CATEGORY_COUNT> bytes{};
+
+    size_t operator[](MemoryCategory category) const;
+    size_t total() const;
+    MemorySnapshot &operator+=(const MemorySnapshot &other);
+    operator string() const;
+  };
+
+  // Byte counters per category. Owners report deltas as their buffers grow or
+  // are released; updates are relaxed atomic adds so a monitoring thread can
+  // take snapshots while indexing runs.
+  class MemoryAccountant
+  {
+  protected:
+    array<atomic<int64_t>, MEMORY_CATEGORY_COUNT> counters{};
+
+  public:
+    void add(MemoryCategory category, int64_t delta);
+    size_t bytes(MemoryCategory category) const;
+    size_t total() const;
+    MemorySnapshot snapshot() const;
+  };
+
+  // Heap bytes owned by a string beyond its own object (0 for short strings
+  // kept inline).
+  size_t heap_bytes(const string &value);
+  size_t memory_usage(const Token &token);
+
+  struct TermStats
+  {
+    uint32_t doc_freq = 0;
+    uint64_t total_freq = 0;
+    uint32_t last_doc = UINT32_MAX;
+  };
+
+  // Document and term frequencies gathered as tokens are produced. Call
+  // begin_document() before feeding the tokens of each document.
+  class TermStatistics
+  {
+  protected:
+    unordered_map<string, TermStats> terms;
+    uint32_t doc_count = 0;
+    uint64_t token_count = 0;
+    size_t bytes = 0;
+
+  public:
+    void begin_document();
+    // Returns true when `text` was not seen before.
+    bool add(const string &text);
+    bool add(const Token &token);
+
+    uint32_t documents() const;
+    uint64_t tokens() const;
+    size_t unique_terms() const;
+    uint32_t doc_freq(const string &text) const;
+    uint64_t total_freq(const string &text) const;
+    size_t memory_usage() const;
+  };
+}
+#endif
@@ -0,0 +1,258 @@
+#include "stored.hpp"
+#include "utils/compression.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  namespace
+  {
+    const string STORED_MAGIC = "RSF1";
+    // Upper bound on raw bytes per compressed byte: one length extension byte
+    // adds at most 255 bytes of output.
+    constexpr uint64_t MAX_EXPANSION = 256;
+
+    void write_varint(string &out, uint64_t value)
+    {
+      while (value >= 0x80)
+      {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+      }
+      out.push_back(static_cast<char>(value));
+    }
+
+    uint64_t read_varint(string_view in, size_t &pos)
+    {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7)
+      {
+        if (pos >= in.size())
+          throw runtime_error("Corrupt stored fields: truncated varint");
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return value;
+      }
+      throw runtime_error("Corrupt stored fields: varint too long");
+    }
+
+    uint32_t read_uint32(string_view in, size_t &pos)
+    {
+      uint64_t value = read_varint(in, pos);
+      if (value > UINT32_MAX)
+        throw runtime_error("Corrupt stored fields: value out of range");
+      return static_cast<uint32_t>(value);
+    }
+
+    string read_bytes(string_view in, size_t &pos)
+    {
+      uint64_t length = read_varint(in, pos);
+      if (length > in.size() - pos)
+        throw runtime_error("Corrupt stored fields: truncated value");
+      string value(in.substr(pos, length));
+      pos += length;
+      return value;
+    }
+  }
+
+  // StoredFieldsWriter
+  StoredFieldsWriter::StoredFieldsWriter(size_t block_size) : block_size(block_size) {};
+  uint32_t StoredFieldsWriter::add(const StoredDocument &document)
+  {
+    uint32_t doc = doc_count++;
+    size_t before = pending.size();
+    write_varint(pending, document.size());
+    for (const StoredField &field : document)
+    {
+      write_varint(pending, field.name.size());
+      pending.append(field.name);
+      write_varint(pending, field.value.size());
+      pending.append(field.value);
+    }
+    pending_lengths.push_back(static_cast<uint32_t>(pending.size() - before));
+    if (pending.size() >= block_size)
+      flush_block();
+    return doc;
+  };
+  size_t StoredFieldsWriter::size() const { return doc_count; };
+  size_t StoredFieldsWriter::memory_usage() const
+  {
+    return pending.capacity() + pending_lengths.capacity() * sizeof(uint32_t) + data.capacity() +
+           blocks.capacity() * sizeof(StoredBlock);
+  };
+  void StoredFieldsWriter::flush_block()
+  {
+    if (pending_lengths.empty())
+      return;
+    string raw;
+    for (uint32_t length : pending_lengths)
+      write_varint(raw, length);
+    raw.append(pending);
+    string compressed = utils::compress(raw);
+
+    StoredBlock block;
+    block.first_doc = doc_count - static_cast<uint32_t>(pending_lengths.size());
+    block.doc_count = static_cast<uint32_t>(pending_lengths.size());
+    block.offset = data.size();
+    block.compressed_size = static_cast<uint32_t>(compressed.size());
+    block.raw_size = static_cast<uint32_t>(raw.size());
+    blocks.push_back(block);
+    data.append(compressed);
+
+    pending.clear();
+    pending_lengths.clear();
+  };
+  StoredFields StoredFieldsWriter::finish()
+  {
+    flush_block();
+    StoredFields stored(move(data), move(blocks));
+    data.clear();
+    blocks.clear();
+    doc_count = 0;
+    return stored;
+  };
+
+  // StoredFields
+  StoredFields::StoredFields(string data, vector<StoredBlock> blocks) : data(move(data)), blocks(move(blocks)) {};
+  size_t StoredFields::size() const { return blocks.empty() ? 0 : blocks.back().first_doc + blocks.back().doc_count; };
+  size_t StoredFields::block_count() const { return blocks.size(); };
+  size_t StoredFields::compressed_bytes() const { return data.size(); };
+  size_t StoredFields::memory_usage() const
+  {
+    return data.capacity() + blocks.capacity() * sizeof(StoredBlock);
+  };
+  size_t StoredFields::find_block(uint32_t doc) const
+  {
+    if (doc >= size())
+      throw out_of_range(format("Document {} is out of range, store holds {}", doc, size()));
+    auto it = upper_bound(blocks.begin(), blocks.end(), doc, [](uint32_t d, const StoredBlock &block)
+                          { return d < block.first_doc; });
+    return static_cast<size_t>(distance(blocks.begin(), it)) - 1;
+  };
+  StoredFields::DecodedBlock StoredFields::decode(size_t block) const
+  {
+    const StoredBlock &entry = blocks[block];
+    if (entry.offset > data.size() || entry.compressed_size > data.size() - entry.offset)
+      throw runtime_error("Corrupt stored fields: block out of bounds");
+    DecodedBlock decoded{block, utils::decompress(string_view(data).substr(entry.offset, entry.compressed_size), entry.raw_size), {}};
+    const string &raw = decoded.raw;
+    if (entry.doc_count > raw.size())
+      throw runtime_error("Corrupt stored fields: block length mismatch");
+
+    size_t pos = 0;
+    vector<uint64_t> lengths(entry.doc_count);
+    for (uint64_t &length : lengths)
+    {
+      length = read_varint(raw, pos);
+      if (length > raw.size())
+        throw runtime_error("Corrupt stored fields: block length mismatch");
+    }
+    decoded.offsets.assign(1, pos);
+    for (uint64_t length : lengths)
+      decoded.offsets.push_back(decoded.offsets.back() + length);
+    if (decoded.offsets.back() != raw.size())
+      throw runtime_error("Corrupt stored fields: block length mismatch");
+    return decoded;
+  };
+  StoredDocument StoredFields::document(const DecodedBlock &decoded, uint32_t doc) const
+  {
+    size_t index = doc - blocks[decoded.block].first_doc;
+    string_view raw = string_view(decoded.raw).substr(0, decoded.offsets[index + 1]);
+    size_t pos = decoded.offsets[index];
+
+    // Every field takes at least two bytes (name and value lengths).
+    uint64_t field_count = read_varint(raw, pos);
+    if (field_count > (raw.size() - pos) / 2)
+      throw runtime_error("Corrupt stored fields: field count exceeds document size");
+    StoredDocument document(field_count);
+    for (StoredField &field : document)
+    {
+      field.name = read_bytes(raw, pos);
+      field.value = read_bytes(raw, pos);
+    }
+    return document;
+  };
+  StoredDocument StoredFields::get(uint32_t doc) const { return document(decode(find_block(doc)), doc); };
+  vector<StoredDocument> StoredFields::get(const vector<uint32_t> &docs) const
+  {
+    // Visit documents in id order so every block is decompressed at most once.
+    vector<size_t> order(docs.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&docs](size_t a, size_t b)
+         { return docs[a] < docs[b]; });
+    vector<StoredDocument> documents(docs.size());
+    optional<DecodedBlock> decoded;
+    for (size_t i : order)
+    {
+      size_t block = find_block(docs[i]);
+      if (!decoded.has_value() || decoded->block != block)
+        decoded = decode(block);
+      documents[i] = document(decoded.value(), docs[i]);
+    }
+    return documents;
+  };
+  void StoredFields::write(ostream &out) const
+  {
+    string header = STORED_MAGIC;
+    write_varint(header, blocks.size());
+    for (const StoredBlock &block : blocks)
+    {
+      write_varint(header, block.first_doc);
+      write_varint(header, block.doc_count);
+      write_varint(header, block.offset);
+      write_varint(header, block.compressed_size);
+      write_varint(header, block.raw_size);
+    }
+    write_varint(header, data.size());
+    out.write(header.data(), static_cast<streamsize>(header.size()));
+    out.write(data.data(), static_cast<streamsize>(data.size()));
+  };
+  StoredFields StoredFields::read(istream &in)
+  {
+    string buffer{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+    if (buffer.compare(0, STORED_MAGIC.size(), STORED_MAGIC) != 0)
+      throw runtime_error("Not a stored fields file");
+    size_t pos = STORED_MAGIC.size();
+    // Every block entry takes at least one byte per varint.
+    uint64_t block_count = read_varint(buffer, pos);
+    if (block_count > (buffer.size() - pos) / 5)
+      throw runtime_error("Corrupt stored fields: block count exceeds file size");
+    vector<StoredBlock> blocks(block_count);
+    for (StoredBlock &block : blocks)
+    {
+      block.first_doc = read_uint32(buffer, pos);
+      block.doc_count = read_uint32(buffer, pos);
+      block.offset = read_varint(buffer, pos);
+      block.compressed_size = read_uint32(buffer, pos);
+      block.raw_size = read_uint32(buffer, pos);
+    }
+    string data = read_bytes(buffer, pos);
+
+    uint64_t next_doc = 0;
+    for (const StoredBlock &block : blocks)
+    {
+      if (block.first_doc != next_doc || block.doc_count == 0)
+        throw runtime_error("Corrupt stored fields: blocks are not contiguous");
+      if (block.offset > data.size() || block.compressed_size > data.size() - block.offset)
+        throw runtime_error("Corrupt stored fields: block out of bounds");
+      if (block.raw_size > static_cast<uint64_t>(block.compressed_size) * MAX_EXPANSION)
+        throw runtime_error("Corrupt stored fields: block raw size too large");
+      next_doc += block.doc_count;
+    }
+    if (next_doc > UINT32_MAX)
+      throw runtime_error("Corrupt stored fields: too many documents");
+    return StoredFields(move(data), move(blocks));
+  };
+}
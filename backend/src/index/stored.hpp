@@ -0,0 +1,91 @@
+#ifndef STORED_HPP
+#define STORED_HPP
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  struct StoredField
+  {
+    string name;
+    string value;
+    bool operator==(const StoredField &other) const = default;
+  };
+
+  using StoredDocument = vector<StoredField>;
+
+  // Entry of the per-block index: which documents a compressed block holds and
+  // where its bytes live in the data section.
+  struct StoredBlock
+  {
+    uint32_t first_doc = 0;
+    uint32_t doc_count = 0;
+    uint64_t offset = 0;
+    uint32_t compressed_size = 0;
+    uint32_t raw_size = 0;
+  };
+
+  // Read side of the stored-fields store. Fetching a document decompresses
+  // only the block holding it, into a buffer local to the call, so concurrent
+  // reads from several threads are safe. Fetching several documents at once
+  // decompresses each block they share only once.
+  class StoredFields
+  {
+  protected:
+    struct DecodedBlock
+    {
+      size_t block;
+      string raw;
+      vector<size_t> offsets;
+    };
+
+    string data;
+    vector<StoredBlock> blocks;
+    DecodedBlock decode(size_t block) const;
+    StoredDocument document(const DecodedBlock &decoded, uint32_t doc) const;
+    size_t find_block(uint32_t doc) const;
+
+  public:
+    StoredFields() = default;
+    StoredFields(string data, vector<StoredBlock> blocks);
+
+    size_t size() const;
+    size_t block_count() const;
+    size_t compressed_bytes() const;
+    size_t memory_usage() const;
+    StoredDocument get(uint32_t doc) const;
+    vector<StoredDocument> get(const vector<uint32_t> &docs) const;
+
+    void write(ostream &out) const;
+    // Throws runtime_error when the stream is not a well-formed store.
+    static StoredFields read(istream &in);
+  };
+
+  // Buffers serialized documents and compresses them into a block each time
+  // `block_size` raw bytes have accumulated. Documents are numbered in the
+  // order they are added, starting from 0.
+  class StoredFieldsWriter
+  {
+  protected:
+    size_t block_size;
+    string pending;
+    vector<uint32_t> pending_lengths;
+    string data;
+    vector<StoredBlock> blocks;
+    uint32_t doc_count = 0;
+    void flush_block();
+
+  public:
+    StoredFieldsWriter(size_t block_size = 16 * 1024);
+    uint32_t add(const StoredDocument &document);
+    size_t size() const;
+    size_t memory_usage() const;
+    StoredFields finish();
+  };
+}
+#endif
@@ -0,0 +1,98 @@
+#include "terms.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  optional<string> prefix_successor(string prefix)
+  {
+    while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xff)
+      prefix.pop_back();
+    if (prefix.empty())
+      return nullopt;
+    prefix.back() = static_cast<char>(static_cast<unsigned char>(prefix.back()) + 1);
+    return prefix;
+  };
+
+  // TermDictionary
+  TermDictionary::TermDictionary(initializer_list<string> terms) : terms(terms), sealed(false) { seal(); };
+  void TermDictionary::seal()
+  {
+    if (sealed)
+      return;
+    sort(terms.begin(), terms.end());
+    terms.erase(unique(terms.begin(), terms.end()), terms.end());
+    sealed = true;
+  };
+  void TermDictionary::check_sealed() const
+  {
+    if (!sealed)
+      throw logic_error("TermDictionary must be sealed before lookups");
+  };
+  void TermDictionary::add(const string &term)
+  {
+    if (sealed && !terms.empty() && terms.back() >= term)
+      sealed = false;
+    terms.push_back(term);
+  };
+  void TermDictionary::add(const Token &token) { add(token.text); };
+  size_t TermDictionary::size() const
+  {
+    check_sealed();
+    return terms.size();
+  };
+  bool TermDictionary::contains(const string &term) const
+  {
+    check_sealed();
+    return binary_search(terms.begin(), terms.end(), term);
+  };
+  const vector<string> &TermDictionary::items() const
+  {
+    check_sealed();
+    return terms;
+  };
+  size_t TermDictionary::memory_usage() const
+  {
+    size_t bytes = terms.capacity() * sizeof(string);
+    for (const string &term : terms)
+      bytes += heap_bytes(term);
+    return bytes;
+  };
+  pair<TermDictionary::const_iterator, TermDictionary::const_iterator> TermDictionary::prefix_range(const string &prefix) const
+  {
+    check_sealed();
+    const_iterator lower = lower_bound(terms.cbegin(), terms.cend(), prefix);
+    optional<string> successor = prefix_successor(prefix);
+    const_iterator upper = successor.has_value()
+                               ? lower_bound(lower, terms.cend(), successor.value())
+                               : terms.cend();
+    return {lower, upper};
+  };
+  vector<string> TermDictionary::prefix(const string &prefix) const
+  {
+    auto [lower, upper] = prefix_range(prefix);
+    return vector<string>(lower, upper);
+  };
+  vector<string> TermDictionary::fuzzy(const string &term, int max_edits, size_t prefix_length) const
+  {
+    if (max_edits < 0 || max_edits > 2)
+      throw invalid_argument(format("max_edits must be between 0 and 2, got {}", max_edits));
+    auto [lower, upper] = prefix_range(term.substr(0, prefix_length));
+    return intersect(LevenshteinAutomaton(term, max_edits), lower, upper);
+  };
+  vector<string> TermDictionary::wildcard(const string &pattern) const
+  {
+    size_t star = pattern.find('*');
+    if (star == string::npos)
+      return contains(pattern) ? vector<string>{pattern} : vector<string>{};
+    auto [lower, upper] = prefix_range(pattern.substr(0, star));
+    return intersect(WildcardAutomaton(pattern), lower, upper);
+  };
+}
@@ -0,0 +1,126 @@
+#ifndef TERMS_HPP
+#define TERMS_HPP
+#pragma once
+#include "analysis/core.hpp"
+#include "automata.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  // Sorted, deduplicated set of analyzed terms. Terms may be added in any
+  // order; seal() then sorts and deduplicates them once. Lookups never modify
+  // the dictionary, so a sealed dictionary can be queried from several
+  // threads, and they throw logic_error on a dictionary that is not sealed.
+  // Adding terms in strictly increasing order keeps it sealed.
+  class TermDictionary
+  {
+  protected:
+    vector<string> terms;
+    bool sealed = true;
+    void check_sealed() const;
+
+  public:
+    using const_iterator = vector<string>::const_iterator;
+
+    TermDictionary() = default;
+    TermDictionary(initializer_list<string> terms);
+    void add(const string &term);
+    void add(const Token &token);
+    template <typename It>
+    void add(It first, It last);
+    void seal();
+
+    size_t size() const;
+    bool contains(const string &term) const;
+    const vector<string> &items() const;
+    size_t memory_usage() const;
+
+    vector<string> prefix(const string &prefix) const;
+    vector<string> fuzzy(const string &term, int max_edits = 2, size_t prefix_length = 0) const;
+    vector<string> wildcard(const string &pattern) const;
+    template <typename Automaton>
+    vector<string> intersect(const Automaton &automaton) const;
+    template <typename Automaton>
+    vector<string> intersect(const Automaton &automaton, const_iterator first, const_iterator last) const;
+
+    // [lower, upper) range of terms starting with `prefix`.
+    pair<const_iterator, const_iterator> prefix_range(const string &prefix) const;
+  };
+
+  // Smallest string greater than every string starting with `prefix`, or
+  // nullopt when no such string exists (empty prefix or all 0xff bytes).
+  optional<string> prefix_successor(string prefix);
+
+  template <typename It>
+  void TermDictionary::add(It first, It last)
+  {
+    for (; first != last; ++first)
+      add(*first);
+  };
+
+  template <typename Automaton>
+  vector<string> TermDictionary::intersect(const Automaton &automaton) const
+  {
+    check_sealed();
+    return intersect(automaton, terms.cbegin(), terms.cend());
+  };
+
+  // Walks the sorted terms keeping one automaton state per byte of the current
+  // term, so consecutive terms only re-run the bytes past their shared prefix.
+  // Once a prefix reaches a state that cannot match, every term carrying that
+  // prefix is skipped with a single binary search instead of being visited.
+  template <typename Automaton>
+  vector<string> TermDictionary::intersect(const Automaton &automaton, const_iterator first, const_iterator last) const
+  {
+    check_sealed();
+    vector<string> matches;
+    vector<typename Automaton::State> states{automaton.start()};
+    const string *previous = nullptr;
+
+    while (first != last)
+    {
+      const string &term = *first;
+      size_t depth = 0;
+      if (previous != nullptr)
+      {
+        size_t limit = min({term.size(), previous->size(), states.size() - 1});
+        while (depth < limit && term[depth] == (*previous)[depth])
+          depth++;
+      }
+      states.resize(depth + 1);
+
+      bool dead = false;
+      for (; depth < term.size(); depth++)
+      {
+        if (!automaton.can_match(states[depth]))
+        {
+          dead = true;
+          break;
+        }
+        states.push_back(automaton.step(states[depth], static_cast<unsigned char>(term[depth])));
+      }
+      previous = &term;
+
+      if (!dead)
+      {
+        if (automaton.is_match(states[depth]))
+          matches.push_back(term);
+        ++first;
+        continue;
+      }
+
+      optional<string> successor = prefix_successor(term.substr(0, depth));
+      if (!successor.has_value())
+        break;
+      first = lower_bound(first, last, successor.value());
+    }
+    return matches;
+  };
+}
+#endif
@@ -0,0 +1,155 @@
+#include "writer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  // Segment
+  const vector<uint32_t> &Segment::postings_for(const string &term) const
+  {
+    static const vector<uint32_t> empty;
+    const vector<string> &items = terms.items();
+    auto it = lower_bound(items.begin(), items.end(), term);
+    if (it == items.end() || *it != term)
+      return empty;
+    return postings[static_cast<size_t>(it - items.begin())];
+  };
+
+  size_t Segment::memory_usage() const
+  {
+    size_t bytes = terms.memory_usage() + stored.memory_usage() + postings.capacity() * sizeof(vector<uint32_t>);
+    for (const vector<uint32_t> &docs : postings)
+      bytes += docs.capacity() * sizeof(uint32_t);
+    return bytes;
+  };
+
+  // InMemoryIndexWriter
+  InMemoryIndexWriter::InMemoryIndexWriter(size_t ram_budget_bytes)
+      : ram_budget_bytes(ram_budget_bytes), accountant(own_accountant) {};
+  InMemoryIndexWriter::InMemoryIndexWriter(MemoryAccountant &accountant, size_t ram_budget_bytes)
+      : ram_budget_bytes(ram_budget_bytes), accountant(accountant) {};
+  InMemoryIndexWriter::~InMemoryIndexWriter()
+  {
+    for (size_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+      charge(static_cast<MemoryCategory>(i), 0);
+  };
+  void InMemoryIndexWriter::charge(MemoryCategory category, size_t bytes)
+  {
+    size_t &current = charged.bytes[static_cast<size_t>(category)];
+    if (bytes == current)
+      return;
+    accountant.add(category, static_cast<int64_t>(bytes) - static_cast<int64_t>(current));
+    current = bytes;
+  };
+  void InMemoryIndexWriter::charge_document_terms()
+  {
+    charge(MemoryCategory::tokens, document_terms.capacity() * sizeof(decltype(document_terms)::value_type));
+  };
+  void InMemoryIndexWriter::add_token(const Token &token, uint32_t doc)
+  {
+    auto [it, inserted] = postings.try_emplace(token.text);
+    vector<uint32_t> &docs = it->second;
+    if (inserted)
+      term_bytes += sizeof(decltype(postings)::value_type) + 2 * sizeof(void *) + heap_bytes(it->first);
+    if (docs.empty() || docs.back() != doc)
+    {
+      size_t capacity = docs.capacity();
+      docs.push_back(doc);
+      postings_bytes += (docs.capacity() - capacity) * sizeof(uint32_t);
+    }
+    document_terms.push_back(&*it);
+  };
+  void InMemoryIndexWriter::rollback_document(uint32_t doc)
+  {
+    // Pop `doc` once per term, then erase the terms it introduced; erasing in
+    // the first pass would leave later entries of the same term dangling.
+    vector<pair<const string, vector<uint32_t>> *> introduced;
+    for (auto *entry : document_terms)
+    {
+      vector<uint32_t> &docs = entry->second;
+      if (docs.empty() || docs.back() != doc)
+        continue;
+      docs.pop_back();
+      if (docs.empty())
+        introduced.push_back(entry);
+    }
+    for (auto *entry : introduced)
+    {
+      term_bytes -= sizeof(decltype(postings)::value_type) + 2 * sizeof(void *) + heap_bytes(entry->first);
+      postings_bytes -= entry->second.capacity() * sizeof(uint32_t);
+      postings.erase(postings.find(entry->first));
+    }
+    document_terms.clear();
+    charge_document_terms();
+  };
+  uint32_t InMemoryIndexWriter::end_document(uint32_t doc)
+  {
+    buffered_docs++;
+    statistics.begin_document();
+    for (auto *entry : document_terms)
+      statistics.add(entry->first);
+    document_terms.clear();
+
+    charge_document_terms();
+    charge(MemoryCategory::terms, term_bytes + postings.bucket_count() * sizeof(void *));
+    charge(MemoryCategory::postings, postings_bytes);
+    charge(MemoryCategory::stored_fields, stored.memory_usage());
+    charge(MemoryCategory::statistics, statistics.memory_usage());
+
+    uint32_t id = flushed_docs + doc;
+    if (should_flush())
+      flush();
+    return id;
+  };
+  size_t InMemoryIndexWriter::buffered_bytes() const
+  {
+    return charged[MemoryCategory::terms] + charged[MemoryCategory::postings] + charged[MemoryCategory::stored_fields];
+  };
+  bool InMemoryIndexWriter::should_flush() const { return buffered_bytes() >= ram_budget_bytes; };
+  void InMemoryIndexWriter::flush()
+  {
+    if (buffered_docs == 0)
+      return;
+
+    vector<pair<string, vector<uint32_t>>> sorted_postings(make_move_iterator(postings.begin()),
+                                                           make_move_iterator(postings.end()));
+    sort(sorted_postings.begin(), sorted_postings.end(), [](const auto &a, const auto &b)
+         { return a.first < b.first; });
+
+    Segment segment;
+    segment.base_doc = flushed_docs;
+    segment.doc_count = buffered_docs;
+    segment.postings.reserve(sorted_postings.size());
+    for (auto &[term, docs] : sorted_postings)
+    {
+      segment.terms.add(term);
+      segment.postings.push_back(move(docs));
+    }
+    segment.terms.seal();
+    segment.stored = stored.finish();
+    segment_bytes += segment.memory_usage();
+    segments.push_back(move(segment));
+
+    flushed_docs += buffered_docs;
+    buffered_docs = 0;
+    unordered_map<string, vector<uint32_t>>().swap(postings);
+    stored = StoredFieldsWriter();
+    term_bytes = 0;
+    postings_bytes = 0;
+    charge(MemoryCategory::terms, 0);
+    charge(MemoryCategory::postings, 0);
+    charge(MemoryCategory::stored_fields, stored.memory_usage());
+    charge(MemoryCategory::segments, segment_bytes);
+  };
+  uint32_t InMemoryIndexWriter::buffered_documents() const { return buffered_docs; };
+  const vector<Segment> &InMemoryIndexWriter::flushed() const { return segments; };
+  const MemorySnapshot &InMemoryIndexWriter::charges() const { return charged; };
+  const MemoryAccountant &InMemoryIndexWriter::memory() const { return accountant; };
+  const TermStatistics &InMemoryIndexWriter::term_statistics() const { return statistics; };
+}
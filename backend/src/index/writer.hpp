@@ -0,0 +1,110 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+#pragma once
+#include "analysis/core.hpp"
+#include "stats.hpp"
+#include "stored.hpp"
+#include "terms.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace indexing
+{
+  using namespace std;
+
+  // Immutable result of a flush. Document ids inside a segment are local;
+  // add base_doc to get the id returned by the writer.
+  struct Segment
+  {
+    uint32_t base_doc = 0;
+    uint32_t doc_count = 0;
+    TermDictionary terms;
+    vector<vector<uint32_t>> postings; // parallel to terms.items()
+    StoredFields stored;
+
+    const vector<uint32_t> &postings_for(const string &term) const;
+    size_t memory_usage() const;
+  };
+
+  // Inverts analyzed documents into an in-memory buffer of postings and
+  // stored fields, flushing it into a Segment once the releasable memory
+  // (terms, postings, stored fields) reaches `ram_budget_bytes`. Token buffers,
+  // term statistics and flushed segments are accounted too but survive
+  // flushes, so they do not count towards the budget.
+  //
+  // Writers may share one MemoryAccountant; each reports deltas against what it
+  // charged itself and releases its charges when destroyed.
+  class InMemoryIndexWriter
+  {
+  protected:
+    size_t ram_budget_bytes;
+    MemoryAccountant own_accountant;
+    MemoryAccountant &accountant;
+    MemorySnapshot charged;
+    TermStatistics statistics;
+    unordered_map<string, vector<uint32_t>> postings;
+    // Postings entry of every token of the document being added, so term
+    // statistics are only updated, and postings rolled back, once the
+    // document's tokens are known. Its capacity is kept between documents and
+    // charged to `tokens`.
+    vector<pair<const string, vector<uint32_t>> *> document_terms;
+    StoredFieldsWriter stored;
+    vector<Segment> segments;
+    uint32_t buffered_docs = 0;
+    uint32_t flushed_docs = 0;
+    size_t term_bytes = 0;
+    size_t postings_bytes = 0;
+    size_t segment_bytes = 0;
+    void charge(MemoryCategory category, size_t bytes);
+    void charge_document_terms();
+    void add_token(const Token &token, uint32_t doc);
+    void rollback_document(uint32_t doc);
+    uint32_t end_document(uint32_t doc);
+
+  public:
+    InMemoryIndexWriter(size_t ram_budget_bytes = 16 * 1024 * 1024);
+    InMemoryIndexWriter(MemoryAccountant &accountant, size_t ram_budget_bytes = 16 * 1024 * 1024);
+    InMemoryIndexWriter(const InMemoryIndexWriter &) = delete;
+    InMemoryIndexWriter &operator=(const InMemoryIndexWriter &) = delete;
+    ~InMemoryIndexWriter();
+    // Tokens are inverted as the iterator yields them; the writer keeps one
+    // pointer per token, not a copy, and the tokenizer's own buffers belong to
+    // the caller. If the iterator throws, the partial document is rolled back
+    // and the exception rethrown; the next document reuses its id.
+    template <typename It>
+    uint32_t add_document(It first, It last, const StoredDocument &document = {});
+
+    size_t buffered_bytes() const;
+    bool should_flush() const;
+    void flush();
+
+    uint32_t buffered_documents() const;
+    const vector<Segment> &flushed() const;
+    // This writer's own charges; memory() may also include other writers
+    // sharing the accountant.
+    const MemorySnapshot &charges() const;
+    const MemoryAccountant &memory() const;
+    const TermStatistics &term_statistics() const;
+  };
+
+  template <typename It>
+  uint32_t InMemoryIndexWriter::add_document(It first, It last, const StoredDocument &document)
+  {
+    uint32_t doc = buffered_docs;
+    try
+    {
+      for (; first != last; ++first)
+        add_token(*first, doc);
+      stored.add(document);
+    }
+    catch (...)
+    {
+      rollback_document(doc);
+      throw;
+    }
+    return end_document(doc);
+  };
+}
+#endif
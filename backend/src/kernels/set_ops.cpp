@@ -0,0 +1,633 @@
+#include "set_ops.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+namespace kernels
+{
+  using namespace std;
+
+  namespace
+  {
+    using List = span<const uint32_t>;
+
+    // First index >= from holding a value >= target, found by doubling the
+    // step and then binary searching the last bracket.
+    size_t gallop(List list, size_t from, uint32_t target)
+    {
+      size_t low = from;
+      size_t high = from;
+      size_t step = 1;
+      while (high < list.size() && list[high] < target)
+      {
+        low = high + 1;
+        high += step;
+        step <<= 1;
+      }
+      high = min(high, list.size());
+      return static_cast<size_t>(lower_bound(list.begin() + low, list.begin() + high, target) - list.begin());
+    }
+
+    size_t copy_range(List list, size_t from, size_t to, uint32_t *out)
+    {
+      if (to > from)
+        memcpy(out, list.data() + from, (to - from) * sizeof(uint32_t));
+      return to - from;
+    }
+
+    size_t intersect_scalar(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      while (i < a.size() && j < b.size())
+      {
+        if (a[i] < b[j])
+          i++;
+        else if (b[j] < a[i])
+          j++;
+        else
+        {
+          out[k++] = a[i];
+          i++;
+          j++;
+        }
+      }
+      return k;
+    }
+
+    size_t intersect_gallop(List small, List large, uint32_t *out)
+    {
+      size_t j = 0, k = 0;
+      for (uint32_t value : small)
+      {
+        j = gallop(large, j, value);
+        if (j == large.size())
+          break;
+        if (large[j] == value)
+          out[k++] = large[j++];
+      }
+      return k;
+    }
+
+    size_t unite_scalar(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      while (i < a.size() && j < b.size())
+      {
+        if (a[i] < b[j])
+          out[k++] = a[i++];
+        else if (b[j] < a[i])
+          out[k++] = b[j++];
+        else
+        {
+          out[k++] = a[i];
+          i++;
+          j++;
+        }
+      }
+      k += copy_range(a, i, a.size(), out + k);
+      k += copy_range(b, j, b.size(), out + k);
+      return k;
+    }
+
+    size_t unite_gallop(List large, List small, uint32_t *out)
+    {
+      size_t i = 0, k = 0;
+      for (uint32_t value : small)
+      {
+        size_t end = gallop(large, i, value);
+        k += copy_range(large, i, end, out + k);
+        i = end;
+        if (i < large.size() && large[i] == value)
+          i++;
+        out[k++] = value;
+      }
+      k += copy_range(large, i, large.size(), out + k);
+      return k;
+    }
+
+    size_t difference_scalar(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      while (i < a.size() && j < b.size())
+      {
+        if (a[i] < b[j])
+          out[k++] = a[i++];
+        else if (b[j] < a[i])
+          j++;
+        else
+        {
+          i++;
+          j++;
+        }
+      }
+      k += copy_range(a, i, a.size(), out + k);
+      return k;
+    }
+
+    // a is much smaller than b: look each value of a up in b.
+    size_t difference_gallop_b(List a, List b, uint32_t *out)
+    {
+      size_t j = 0, k = 0;
+      for (uint32_t value : a)
+      {
+        j = gallop(b, j, value);
+        if (j < b.size() && b[j] == value)
+          j++;
+        else
+          out[k++] = value;
+      }
+      return k;
+    }
+
+    // a is much larger than b: copy the runs of a between values of b.
+    size_t difference_gallop_a(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, k = 0;
+      for (uint32_t value : b)
+      {
+        size_t end = gallop(a, i, value);
+        k += copy_range(a, i, end, out + k);
+        i = end;
+        if (i < a.size() && a[i] == value)
+          i++;
+      }
+      k += copy_range(a, i, a.size(), out + k);
+      return k;
+    }
+
+#ifdef KERNELS_X86
+    // pack4[mask] is a byte shuffle moving the 32-bit lanes set in `mask` to
+    // the front; pack8[mask] is the same as a lane permutation for AVX2.
+    constexpr array<array<uint8_t, 16>, 16> make_pack4()
+    {
+      array<array<uint8_t, 16>, 16> table{};
+      for (size_t mask = 0; mask < 16; mask++)
+      {
+        size_t out = 0;
+        for (uint8_t lane = 0; lane < 4; lane++)
+          if (mask & (size_t(1) << lane))
+          {
+            for (uint8_t byte = 0; byte < 4; byte++)
+              table[mask][out * 4 + byte] = static_cast<uint8_t>(lane * 4 + byte);
+            out++;
+          }
+        for (size_t byte = out * 4; byte < 16; byte++)
+          table[mask][byte] = 0x80;
+      }
+      return table;
+    }
+
+    constexpr array<array<uint32_t, 8>, 256> make_pack8()
+    {
+      array<array<uint32_t, 8>, 256> table{};
+      for (size_t mask = 0; mask < 256; mask++)
+      {
+        size_t out = 0;
+        for (uint32_t lane = 0; lane < 8; lane++)
+          if (mask & (size_t(1) << lane))
+            table[mask][out++] = lane;
+      }
+      return table;
+    }
+
+    alignas(16) constexpr array<array<uint8_t, 16>, 16> pack4 = make_pack4();
+    alignas(32) constexpr array<array<uint32_t, 8>, 256> pack8 = make_pack8();
+
+    __attribute__((target("sse4.1"))) inline int match_mask_sse41(__m128i va, __m128i vb)
+    {
+      __m128i r1 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+      __m128i r2 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+      __m128i r3 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3));
+      __m128i cmp = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, r1)),
+                                 _mm_or_si128(_mm_cmpeq_epi32(va, r2), _mm_cmpeq_epi32(va, r3)));
+      return _mm_movemask_ps(_mm_castsi128_ps(cmp));
+    }
+
+    __attribute__((target("sse4.1"))) inline __m128i pack_sse41(__m128i v, int mask)
+    {
+      return _mm_shuffle_epi8(v, _mm_load_si128(reinterpret_cast<const __m128i *>(pack4[mask].data())));
+    }
+
+    __attribute__((target("avx2"))) inline int match_mask_avx2(__m256i va, __m256i vb)
+    {
+      __m256i cmp = _mm256_cmpeq_epi32(va, vb);
+      for (int r = 1; r < 8; r++)
+      {
+        __m256i rotation = _mm256_setr_epi32(r, (r + 1) & 7, (r + 2) & 7, (r + 3) & 7,
+                                             (r + 4) & 7, (r + 5) & 7, (r + 6) & 7, (r + 7) & 7);
+        cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotation)));
+      }
+      return _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+    }
+
+    __attribute__((target("avx2"))) inline __m256i pack_avx2(__m256i v, int mask)
+    {
+      return _mm256_permutevar8x32_epi32(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(pack8[mask].data())));
+    }
+
+    // Compares every block of 4 from a against every overlapping block of 4
+    // from b and packs the matching lanes of a. Each block pair is visited
+    // once, so a match is written once. Full-width stores are only used while
+    // they stay within the min(a, b) values `out` is guaranteed to hold.
+    __attribute__((target("sse4.1"))) size_t intersect_sse41(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      size_t capacity = min(a.size(), b.size());
+      size_t a_blocks = a.size() & ~size_t(3), b_blocks = b.size() & ~size_t(3);
+      if (a_blocks && b_blocks)
+      {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data()));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data()));
+        while (true)
+        {
+          int mask = match_mask_sse41(va, vb);
+          size_t count = static_cast<size_t>(__builtin_popcount(mask));
+          if (k + 4 <= capacity)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k), pack_sse41(va, mask));
+          else
+          {
+            alignas(16) uint32_t packed[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(packed), pack_sse41(va, mask));
+            memcpy(out + k, packed, count * sizeof(uint32_t));
+          }
+          k += count;
+          uint32_t a_max = a[i + 3], b_max = b[j + 3];
+          if (a_max <= b_max)
+          {
+            i += 4;
+            if (i == a_blocks)
+              break;
+            va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i));
+          }
+          if (b_max <= a_max)
+          {
+            j += 4;
+            if (j == b_blocks)
+              break;
+            vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + j));
+          }
+        }
+      }
+      return k + intersect_scalar(a.subspan(i), b.subspan(j), out + k);
+    }
+
+    __attribute__((target("avx2"))) size_t intersect_avx2(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      size_t capacity = min(a.size(), b.size());
+      size_t a_blocks = a.size() & ~size_t(7), b_blocks = b.size() & ~size_t(7);
+      if (a_blocks && b_blocks)
+      {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.data()));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.data()));
+        while (true)
+        {
+          int mask = match_mask_avx2(va, vb);
+          size_t count = static_cast<size_t>(__builtin_popcount(mask));
+          if (k + 8 <= capacity)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), pack_avx2(va, mask));
+          else
+          {
+            alignas(32) uint32_t packed[8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(packed), pack_avx2(va, mask));
+            memcpy(out + k, packed, count * sizeof(uint32_t));
+          }
+          k += count;
+          uint32_t a_max = a[i + 7], b_max = b[j + 7];
+          if (a_max <= b_max)
+          {
+            i += 8;
+            if (i == a_blocks)
+              break;
+            va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.data() + i));
+          }
+          if (b_max <= a_max)
+          {
+            j += 8;
+            if (j == b_blocks)
+              break;
+            vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.data() + j));
+          }
+        }
+      }
+      return k + intersect_scalar(a.subspan(i), b.subspan(j), out + k);
+    }
+
+    // Finishes a blocked difference: lanes of the current a block flagged in
+    // `found` already matched an earlier block of b.
+    size_t difference_tail(List a, size_t i, size_t lanes, int found, List b, size_t j, uint32_t *out)
+    {
+      size_t k = 0;
+      for (size_t x = i; x < a.size(); x++)
+      {
+        if (x < i + lanes && (found >> (x - i)) & 1)
+          continue;
+        while (j < b.size() && b[j] < a[x])
+          j++;
+        if (j < b.size() && b[j] == a[x])
+          continue;
+        out[k++] = a[x];
+      }
+      return k;
+    }
+
+    // Accumulates which lanes of the current a block occur in b, and packs
+    // the remaining lanes once b has moved past the block.
+    __attribute__((target("sse4.1"))) size_t difference_sse41(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      int found = 0;
+      size_t a_blocks = a.size() & ~size_t(3), b_blocks = b.size() & ~size_t(3);
+      if (a_blocks && b_blocks)
+      {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data()));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data()));
+        while (true)
+        {
+          found |= match_mask_sse41(va, vb);
+          uint32_t a_max = a[i + 3], b_max = b[j + 3];
+          if (a_max <= b_max)
+          {
+            int keep = ~found & 0xf;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k), pack_sse41(va, keep));
+            k += static_cast<size_t>(__builtin_popcount(keep));
+            found = 0;
+            i += 4;
+            if (i == a_blocks)
+              break;
+            va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i));
+          }
+          if (b_max <= a_max)
+          {
+            j += 4;
+            if (j == b_blocks)
+              break;
+            vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + j));
+          }
+        }
+      }
+      return k + difference_tail(a, i, 4, found, b, j, out + k);
+    }
+
+    __attribute__((target("avx2"))) size_t difference_avx2(List a, List b, uint32_t *out)
+    {
+      size_t i = 0, j = 0, k = 0;
+      int found = 0;
+      size_t a_blocks = a.size() & ~size_t(7), b_blocks = b.size() & ~size_t(7);
+      if (a_blocks && b_blocks)
+      {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.data()));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.data()));
+        while (true)
+        {
+          found |= match_mask_avx2(va, vb);
+          uint32_t a_max = a[i + 7], b_max = b[j + 7];
+          if (a_max <= b_max)
+          {
+            int keep = ~found & 0xff;
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), pack_avx2(va, keep));
+            k += static_cast<size_t>(__builtin_popcount(keep));
+            found = 0;
+            i += 8;
+            if (i == a_blocks)
+              break;
+            va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.data() + i));
+          }
+          if (b_max <= a_max)
+          {
+            j += 8;
+            if (j == b_blocks)
+              break;
+            vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.data() + j));
+          }
+        }
+      }
+      return k + difference_tail(a, i, 8, found, b, j, out + k);
+    }
+
+    // Bitonic merge of two sorted blocks of 4 into the 4 smallest (low) and
+    // 4 largest (high) values, both sorted.
+    __attribute__((target("sse4.1"))) inline void merge_sse41(__m128i first, __m128i second, __m128i &low, __m128i &high)
+    {
+      __m128i tmp = _mm_min_epu32(first, second);
+      high = _mm_max_epu32(first, second);
+      tmp = _mm_alignr_epi8(tmp, tmp, 4);
+      low = _mm_min_epu32(tmp, high);
+      high = _mm_max_epu32(tmp, high);
+      tmp = _mm_alignr_epi8(low, low, 4);
+      low = _mm_min_epu32(tmp, high);
+      high = _mm_max_epu32(tmp, high);
+      tmp = _mm_alignr_epi8(low, low, 4);
+      low = _mm_min_epu32(tmp, high);
+      high = _mm_max_epu32(tmp, high);
+      low = _mm_alignr_epi8(low, low, 4);
+    }
+
+    // Writes the lanes of `block` that differ from their predecessor, the
+    // first lane being compared with the last lane of `previous`.
+    __attribute__((target("sse4.1"))) inline size_t store_unique_sse41(__m128i previous, __m128i block, uint32_t *out)
+    {
+      __m128i shifted = _mm_alignr_epi8(block, previous, 12);
+      int keep = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(shifted, block))) & 0xf;
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), pack_sse41(block, keep));
+      return static_cast<size_t>(__builtin_popcount(keep));
+    }
+
+    // Streams blocks into a merge network, always feeding the block whose head
+    // is smallest, and deduplicates the sorted output on the fly.
+    __attribute__((target("sse4.1"))) size_t unite_sse41(List a, List b, uint32_t *out)
+    {
+      if (a.size() < 4 || b.size() < 4)
+        return unite_scalar(a, b, out);
+      size_t i = 4, j = 4, k = 0;
+      size_t a_blocks = a.size() & ~size_t(3), b_blocks = b.size() & ~size_t(3);
+      __m128i low, high;
+      // The first value can never be UINT32_MAX, so an all-ones predecessor
+      // never hides it.
+      __m128i previous = _mm_set1_epi32(-1);
+      merge_sse41(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data())),
+                  _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data())), low, high);
+      k += store_unique_sse41(previous, low, out + k);
+      previous = low;
+      while (i < a_blocks && j < b_blocks)
+      {
+        __m128i next;
+        if (a[i] <= b[j])
+        {
+          next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i));
+          i += 4;
+        }
+        else
+        {
+          next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + j));
+          j += 4;
+        }
+        merge_sse41(next, high, low, high);
+        k += store_unique_sse41(previous, low, out + k);
+        previous = low;
+      }
+
+      // Three-way merge of the pending high block with both tails.
+      alignas(16) uint32_t pending[4];
+      _mm_store_si128(reinterpret_cast<__m128i *>(pending), high);
+      uint32_t last = out[k - 1];
+      size_t p = 0;
+      while (p < 4 || i < a.size() || j < b.size())
+      {
+        uint32_t value;
+        if (p < 4 && (i >= a.size() || pending[p] <= a[i]) && (j >= b.size() || pending[p] <= b[j]))
+          value = pending[p++];
+        else if (i < a.size() && (j >= b.size() || a[i] <= b[j]))
+          value = a[i++];
+        else
+          value = b[j++];
+        if (value != last)
+          out[k++] = last = value;
+      }
+      return k;
+    }
+#endif
+  }
+
+  string isa_name(Isa isa)
+  {
+    switch (isa)
+    {
+    case Isa::sse41:
+      return "sse4.1";
+    case Isa::avx2:
+      return "avx2";
+    default:
+      return "scalar";
+    }
+  };
+
+  Isa best_isa()
+  {
+    static const Isa detected = []
+    {
+#ifdef KERNELS_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+        return Isa::avx2;
+      if (__builtin_cpu_supports("sse4.1"))
+        return Isa::sse41;
+#endif
+      return Isa::scalar;
+    }();
+    return detected;
+  };
+
+  bool supports(Isa isa) { return static_cast<int>(isa) <= static_cast<int>(best_isa()); };
+
+  size_t default_gallop_ratio(SetOp op, Isa isa)
+  {
+    // Rows follow Isa, columns SetOp. Union has no AVX2 kernel, so AVX2 reuses
+    // the SSE4.1 crossover.
+    static constexpr size_t ratios[3][3] = {
+        {48, 64, 64},
+        {32, 64, 32},
+        {128, 64, 128},
+    };
+    return ratios[static_cast<size_t>(isa)][static_cast<size_t>(op)];
+  };
+
+  static void check_isa(Isa isa)
+  {
+    if (!supports(isa))
+      throw invalid_argument(format("Instruction set {} is not supported on this CPU", isa_name(isa)));
+  };
+
+  size_t intersect(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa, size_t gallop_ratio)
+  {
+    check_isa(isa);
+    if (a.size() > b.size())
+      swap(a, b);
+    if (a.empty())
+      return 0;
+    if (gallop_ratio == 0)
+      gallop_ratio = default_gallop_ratio(SetOp::intersect, isa);
+    if (b.size() / a.size() >= gallop_ratio)
+      return intersect_gallop(a, b, out);
+#ifdef KERNELS_X86
+    if (isa == Isa::avx2)
+      return intersect_avx2(a, b, out);
+    if (isa == Isa::sse41)
+      return intersect_sse41(a, b, out);
+#endif
+    return intersect_scalar(a, b, out);
+  };
+
+  size_t unite(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa, size_t gallop_ratio)
+  {
+    check_isa(isa);
+    if (a.size() < b.size())
+      swap(a, b);
+    if (b.empty())
+      return copy_range(a, 0, a.size(), out);
+    if (gallop_ratio == 0)
+      gallop_ratio = default_gallop_ratio(SetOp::unite, isa);
+    if (a.size() / b.size() >= gallop_ratio)
+      return unite_gallop(a, b, out);
+#ifdef KERNELS_X86
+    if (isa != Isa::scalar)
+      return unite_sse41(a, b, out);
+#endif
+    return unite_scalar(a, b, out);
+  };
+
+  size_t difference(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa, size_t gallop_ratio)
+  {
+    check_isa(isa);
+    if (a.empty())
+      return 0;
+    if (b.empty())
+      return copy_range(a, 0, a.size(), out);
+    if (gallop_ratio == 0)
+      gallop_ratio = default_gallop_ratio(SetOp::difference, isa);
+    if (b.size() / a.size() >= gallop_ratio)
+      return difference_gallop_b(a, b, out);
+    if (a.size() / b.size() >= gallop_ratio)
+      return difference_gallop_a(a, b, out);
+#ifdef KERNELS_X86
+    if (isa == Isa::avx2)
+      return difference_avx2(a, b, out);
+    if (isa == Isa::sse41)
+      return difference_sse41(a, b, out);
+#endif
+    return difference_scalar(a, b, out);
+  };
+
+  vector<uint32_t> intersect(span<const uint32_t> a, span<const uint32_t> b)
+  {
+    vector<uint32_t> out(min(a.size(), b.size()));
+    out.resize(intersect(a, b, out.data()));
+    return out;
+  };
+
+  vector<uint32_t> unite(span<const uint32_t> a, span<const uint32_t> b)
+  {
+    vector<uint32_t> out(a.size() + b.size());
+    out.resize(unite(a, b, out.data()));
+    return out;
+  };
+
+  vector<uint32_t> difference(span<const uint32_t> a, span<const uint32_t> b)
+  {
+    vector<uint32_t> out(a.size());
+    out.resize(difference(a, b, out.data()));
+    return out;
+  };
+}
@@ -0,0 +1,56 @@
+#ifndef SET_OPS_HPP
+#define SET_OPS_HPP
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace kernels
+{
+  using namespace std;
+
+  enum class Isa
+  {
+    scalar,
+    sse41,
+    avx2
+  };
+
+  string isa_name(Isa isa);
+  bool supports(Isa isa);
+  // Widest instruction set available on this CPU, detected once.
+  Isa best_isa();
+
+  enum class SetOp
+  {
+    intersect,
+    unite,
+    difference
+  };
+
+  // Size ratio from which galloping through the larger list beats the merge
+  // kernel of `isa` for `op`, taken from bench_kernels. Wider merge kernels
+  // stay ahead for longer: 128 for AVX2 intersection and difference, against
+  // 32-64 elsewhere. The raw overloads take the ratio as `gallop_ratio`: 0
+  // uses this table, 1 always gallops and SIZE_MAX never does.
+  size_t default_gallop_ratio(SetOp op, Isa isa);
+
+  // Set operations over strictly increasing uint32 lists (e.g. doc ids).
+  // The raw overloads write to `out` and return the number of values written;
+  // `out` must have room for min(a, b) values for intersect, a + b for unite
+  // and a for difference. Intersection and difference have SSE4.1 and AVX2
+  // kernels; union has an SSE4.1 kernel, also used under AVX2.
+  size_t intersect(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa = best_isa(),
+                   size_t gallop_ratio = 0);
+  size_t unite(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa = best_isa(),
+               size_t gallop_ratio = 0);
+  size_t difference(span<const uint32_t> a, span<const uint32_t> b, uint32_t *out, Isa isa = best_isa(),
+                    size_t gallop_ratio = 0);
+
+  vector<uint32_t> intersect(span<const uint32_t> a, span<const uint32_t> b);
+  vector<uint32_t> unite(span<const uint32_t> a, span<const uint32_t> b);
+  vector<uint32_t> difference(span<const uint32_t> a, span<const uint32_t> b);
+}
+#endif
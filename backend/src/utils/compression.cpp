@@ -0,0 +1,124 @@
+#include "compression.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+namespace {
+
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t MAX_OFFSET = 0xffff;
+constexpr int HASH_BITS = 14;
+
+std::uint32_t read32(const char *p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint32_t hash(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void write_length(std::string &out, std::size_t length) {
+    for (; length >= 255; length -= 255)
+        out.push_back(static_cast<char>(255));
+    out.push_back(static_cast<char>(length));
+}
+
+void write_sequence(std::string &out, std::string_view literals, std::size_t match_length, std::size_t offset) {
+    std::size_t extra_match = match_length ? match_length - MIN_MATCH : 0;
+    std::uint8_t token = static_cast<std::uint8_t>((std::min<std::size_t>(literals.size(), 15) << 4) |
+                                                   std::min<std::size_t>(extra_match, 15));
+    out.push_back(static_cast<char>(token));
+    if (literals.size() >= 15)
+        write_length(out, literals.size() - 15);
+    out.append(literals);
+    if (!match_length)
+        return;
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (extra_match >= 15)
+        write_length(out, extra_match - 15);
+}
+
+std::size_t read_length(std::string_view input, std::size_t &pos, std::size_t length) {
+    if (length != 15)
+        return length;
+    std::uint8_t byte;
+    do {
+        if (pos >= input.size())
+            throw std::runtime_error("Corrupt compressed block: truncated length");
+        byte = static_cast<std::uint8_t>(input[pos++]);
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+}
+
+std::string compress(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    std::vector<std::uint32_t> table(std::size_t(1) << HASH_BITS, UINT32_MAX);
+
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    while (input.size() >= MIN_MATCH && pos <= input.size() - MIN_MATCH) {
+        std::uint32_t sequence = read32(input.data() + pos);
+        std::uint32_t &slot = table[hash(sequence)];
+        std::size_t candidate = slot;
+        slot = static_cast<std::uint32_t>(pos);
+        if (candidate == UINT32_MAX || pos - candidate > MAX_OFFSET || read32(input.data() + candidate) != sequence) {
+            pos++;
+            continue;
+        }
+        std::size_t length = MIN_MATCH;
+        while (pos + length < input.size() && input[candidate + length] == input[pos + length])
+            length++;
+        write_sequence(out, input.substr(anchor, pos - anchor), length, pos - candidate);
+        pos += length;
+        anchor = pos;
+    }
+    write_sequence(out, input.substr(anchor), 0, 0);
+    return out;
+}
+
+std::string decompress(std::string_view input, std::size_t raw_size) {
+    std::string out;
+    out.reserve(raw_size);
+    std::size_t pos = 0;
+    while (pos < input.size()) {
+        std::uint8_t token = static_cast<std::uint8_t>(input[pos++]);
+        std::size_t literals = read_length(input, pos, token >> 4);
+        if (literals > input.size() - pos || out.size() + literals > raw_size)
+            throw std::runtime_error("Corrupt compressed block: literals overrun");
+        out.append(input.substr(pos, literals));
+        pos += literals;
+        if (pos == input.size())
+            break;
+
+        if (input.size() - pos < 2)
+            throw std::runtime_error("Corrupt compressed block: truncated offset");
+        std::size_t offset = static_cast<std::uint8_t>(input[pos]) |
+                             (static_cast<std::size_t>(static_cast<std::uint8_t>(input[pos + 1])) << 8);
+        pos += 2;
+        std::size_t length = read_length(input, pos, token & 0x0f) + MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + length > raw_size)
+            throw std::runtime_error("Corrupt compressed block: bad match");
+        // Byte-wise copy: overlapping matches repeat the most recent bytes.
+        std::size_t from = out.size() - offset;
+        for (std::size_t i = 0; i < length; i++)
+            out.push_back(out[from + i]);
+    }
+    if (out.size() != raw_size)
+        throw std::runtime_error("Corrupt compressed block: size mismatch");
+    return out;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+// LZ4-style block compression: a stream of sequences, each made of a token
+// byte (literal length in the high nibble, match length - 4 in the low one),
+// optional length extension bytes, the literals, and a 16-bit little-endian
+// back-reference offset. The last sequence carries literals only.
+std::string compress(std::string_view input);
+
+// Inverse of compress(). `raw_size` is the exact size of the original input;
+// throws std::runtime_error when the block is corrupt.
+std::string decompress(std::string_view input, std::size_t raw_size);
+
+}
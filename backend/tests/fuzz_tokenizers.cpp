@@ -0,0 +1,55 @@
+#include "tokenizer_harness.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
+using namespace std;
+using namespace analysis;
+using namespace harness;
+
+// Tokenizer copies leak their current token, so LeakSanitizer would stop every
+// run on the first input; leak checking is left to the unit tests.
+extern "C" const char *__asan_default_options() { return "detect_leaks=0"; }
+
+// libFuzzer entry point: the first byte selects the tokenizer config, the
+// second the start_char offset, and the rest is the text to tokenize. Any
+// divergence between the reference tokenizer and an engine aborts the run.
+//
+// The low four bits of the first byte are output flags. Unless both top bits
+// are set, the config uses the default pattern, which scan_words supports, so
+// three quarters of the flag space compares an engine. The remaining quarter
+// takes gaps and tokenize from bits 4-5 and the pattern from the low bits of
+// the second byte, and only runs the reference.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 2)
+        return 0;
+    static const string patterns[] = {TokenizerConfig().pattern, "[A-Z]+", "\\s+", "[^/]+"};
+    uint8_t flags = data[0];
+    string text(reinterpret_cast<const char *>(data + 2), size - 2);
+
+    TokenizerConfig config;
+    config.text = &text;
+    config.positions = flags & 0x01;
+    config.chars = flags & 0x02;
+    config.keep_original = flags & 0x04;
+    config.remove_stops = flags & 0x08;
+    config.start_char = data[1];
+    if ((flags & 0xc0) == 0xc0)
+    {
+        config.gaps = flags & 0x10;
+        config.tokenize = !(flags & 0x20);
+        config.pattern = patterns[data[1] & 0x03];
+    }
+
+    EngineCheck check = check_engines(config, reference_regex, regex_engines());
+    if (check.mismatch.has_value())
+    {
+        fprintf(stderr, "%s\n", check.mismatch.value().c_str());
+        abort();
+    }
+    return 0;
+}
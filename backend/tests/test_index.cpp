@@ -0,0 +1,421 @@
+#include "gtest/gtest.h"
+#include "analysis/tokenizers.hpp"
+#include "index/stored.hpp"
+#include "index/stats.hpp"
+#include "index/terms.hpp"
+#include "index/writer.hpp"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace analysis;
+using namespace indexing;
+
+static int edit_distance(const string &a, const string &b)
+{
+    vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++)
+        row[j] = static_cast<int>(j);
+    for (size_t i = 1; i <= a.size(); i++)
+    {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= b.size(); j++)
+        {
+            int above = row[j];
+            row[j] = min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+static TermDictionary sample_dictionary()
+{
+    return TermDictionary{"apple", "apply", "ample", "maple", "banana", "band", "bandana",
+                          "can", "cane", "candle", "cat", "catalog", "dog", "a", "ab", ""};
+}
+
+TEST(IndexTest, TestTermDictionaryFromTokens)
+{
+    string test_string = "bravo alfa charlie alfa";
+    RegexTokenizer regex_tokenizer = RegexTokenizer({.text = &test_string});
+    TermDictionary dictionary;
+    dictionary.add(begin(regex_tokenizer), end(regex_tokenizer));
+    EXPECT_THROW(dictionary.contains("bravo"), logic_error);
+    EXPECT_THROW(dictionary.prefix("b"), logic_error);
+
+    dictionary.seal();
+    vector<string> expected_terms{"alfa", "bravo", "charlie"};
+    EXPECT_EQ(dictionary.items(), expected_terms);
+    EXPECT_TRUE(dictionary.contains("bravo"));
+    EXPECT_FALSE(dictionary.contains("delta"));
+}
+
+TEST(IndexTest, TestTermDictionaryConcurrentLookups)
+{
+    TermDictionary dictionary;
+    for (string term : {"delta", "alfa", "charlie", "bravo", "alfa", "echo"})
+        dictionary.add(term);
+    dictionary.seal();
+
+    vector<thread> readers;
+    vector<int> mismatches(4, 0);
+    for (size_t t = 0; t < 4; t++)
+        readers.emplace_back([&dictionary, &mismatches, t]
+                             {
+            for (int round = 0; round < 200; round++)
+                if (dictionary.prefix("b") != vector<string>{"bravo"} ||
+                    dictionary.fuzzy("alfo", 1) != vector<string>{"alfa"})
+                    mismatches[t]++; });
+    for (thread &reader : readers)
+        reader.join();
+    EXPECT_EQ(mismatches, vector<int>(4, 0));
+}
+
+TEST(IndexTest, TestPrefix)
+{
+    TermDictionary dictionary = sample_dictionary();
+    vector<string> expected_terms{"band", "bandana"};
+    EXPECT_EQ(dictionary.prefix("band"), expected_terms);
+    EXPECT_EQ(dictionary.prefix("zz"), vector<string>{});
+    EXPECT_EQ(dictionary.prefix("").size(), dictionary.size());
+}
+
+TEST(IndexTest, TestFuzzy)
+{
+    TermDictionary dictionary = sample_dictionary();
+    vector<string> expected_terms{"apple", "apply"};
+    EXPECT_EQ(dictionary.fuzzy("appel", 2), expected_terms);
+    expected_terms = {"can", "cane", "cat"};
+    EXPECT_EQ(dictionary.fuzzy("can", 1), expected_terms);
+    expected_terms = {"can", "cane"};
+    EXPECT_EQ(dictionary.fuzzy("cane", 1, 3), expected_terms);
+    EXPECT_EQ(dictionary.fuzzy("dane", 1, 1), vector<string>{});
+    expected_terms = {"cane"};
+    EXPECT_EQ(dictionary.fuzzy("cafe", 1, 2), expected_terms);
+    EXPECT_THROW(dictionary.fuzzy("cane", 3), invalid_argument);
+}
+
+TEST(IndexTest, TestFuzzyMatchesBruteForce)
+{
+    TermDictionary dictionary = sample_dictionary();
+    for (string query : {"", "a", "ab", "bandanna", "catalgo", "dgo", "mapel"})
+        for (int max_edits = 0; max_edits <= 2; max_edits++)
+        {
+            vector<string> expected_terms;
+            for (const string &term : dictionary.items())
+                if (edit_distance(query, term) <= max_edits)
+                    expected_terms.push_back(term);
+            EXPECT_EQ(dictionary.fuzzy(query, max_edits), expected_terms) << query << " " << max_edits;
+        }
+}
+
+TEST(IndexTest, TestWildcard)
+{
+    TermDictionary dictionary = sample_dictionary();
+    vector<string> expected_terms{"can", "candle", "cane"};
+    EXPECT_EQ(dictionary.wildcard("can*"), expected_terms);
+    expected_terms = {"ample", "apple", "maple"};
+    EXPECT_EQ(dictionary.wildcard("*ple"), expected_terms);
+    expected_terms = {"band", "bandana"};
+    EXPECT_EQ(dictionary.wildcard("b*nd*"), expected_terms);
+    expected_terms = {"cat"};
+    EXPECT_EQ(dictionary.wildcard("cat"), expected_terms);
+    EXPECT_EQ(dictionary.wildcard("*").size(), dictionary.size());
+}
+
+static StoredDocument sample_document(uint32_t doc)
+{
+    return {{"id", to_string(doc)}, {"original", format("document {} about alfa bravo charlie", doc)}};
+}
+
+TEST(IndexTest, TestStoredFields)
+{
+    StoredFieldsWriter writer(256);
+    for (uint32_t doc = 0; doc < 100; doc++)
+        EXPECT_EQ(writer.add(sample_document(doc)), doc);
+    writer.add({});
+    StoredFields stored = writer.finish();
+
+    EXPECT_EQ(stored.size(), 101u);
+    EXPECT_GT(stored.block_count(), 1u);
+    EXPECT_EQ(stored.get(0), sample_document(0));
+    EXPECT_EQ(stored.get(57), sample_document(57));
+    EXPECT_EQ(stored.get(100), StoredDocument{});
+    EXPECT_THROW(stored.get(101), out_of_range);
+
+    vector<StoredDocument> documents = stored.get(vector<uint32_t>{99, 3, 42});
+    vector<StoredDocument> expected_documents{sample_document(99), sample_document(3), sample_document(42)};
+    EXPECT_EQ(documents, expected_documents);
+}
+
+TEST(IndexTest, TestStoredFieldsPersistence)
+{
+    StoredFieldsWriter writer(128);
+    for (uint32_t doc = 0; doc < 20; doc++)
+        writer.add(sample_document(doc));
+    stringstream stream;
+    writer.finish().write(stream);
+
+    StoredFields stored = StoredFields::read(stream);
+    EXPECT_EQ(stored.size(), 20u);
+    for (uint32_t doc = 0; doc < 20; doc++)
+        EXPECT_EQ(stored.get(doc), sample_document(doc));
+
+    stringstream garbage("not stored fields");
+    EXPECT_THROW(StoredFields::read(garbage), runtime_error);
+}
+
+TEST(IndexTest, TestStoredFieldsConcurrentReads)
+{
+    StoredFieldsWriter writer(128);
+    for (uint32_t doc = 0; doc < 200; doc++)
+        writer.add(sample_document(doc));
+    const StoredFields stored = writer.finish();
+
+    vector<thread> readers;
+    vector<int> mismatches(4, 0);
+    for (size_t t = 0; t < 4; t++)
+        readers.emplace_back([&stored, &mismatches, t]
+                             {
+            for (uint32_t round = 0; round < 20; round++)
+                for (uint32_t doc = static_cast<uint32_t>(t); doc < 200; doc += 4)
+                    if (stored.get(doc) != sample_document(doc))
+                        mismatches[t]++; });
+    for (thread &reader : readers)
+        reader.join();
+    EXPECT_EQ(mismatches, vector<int>(4, 0));
+}
+
+static StoredFields read_store(const string &bytes)
+{
+    stringstream stream(bytes);
+    return StoredFields::read(stream);
+}
+
+static string write_store(const StoredFields &stored)
+{
+    stringstream stream;
+    stored.write(stream);
+    return stream.str();
+}
+
+TEST(IndexTest, TestStoredFieldsCorruptHeader)
+{
+    StoredFieldsWriter writer(128);
+    for (uint32_t doc = 0; doc < 20; doc++)
+        writer.add(sample_document(doc));
+    string valid = write_store(writer.finish());
+    StoredFields stored = read_store(valid);
+    string data(valid.end() - static_cast<ptrdiff_t>(stored.compressed_bytes()), valid.end());
+
+    EXPECT_THROW(read_store(string("RSF1\xff\xff\xff\xff\x0f", 9)), runtime_error);
+    EXPECT_THROW(read_store(write_store(StoredFields(data, {{1, 20, 0, 10, 20}}))), runtime_error);
+    EXPECT_THROW(read_store(write_store(StoredFields(data, {{0, 5, 0, 10, 20}, {6, 5, 10, 10, 20}}))), runtime_error);
+    EXPECT_THROW(read_store(write_store(StoredFields(data, {{0, 0, 0, 10, 20}}))), runtime_error);
+    EXPECT_THROW(read_store(write_store(StoredFields(data, {{0, 20, data.size() - 5, 10, 20}}))), runtime_error);
+    EXPECT_THROW(read_store(write_store(StoredFields(data, {{0, 20, UINT64_MAX - 5, 10, 20}}))), runtime_error);
+
+    // Flipping any byte must either leave a readable store or throw.
+    mt19937 rng(11);
+    for (size_t i = 0; i < valid.size(); i++)
+    {
+        string corrupt = valid;
+        corrupt[i] = static_cast<char>(corrupt[i] ^ (1 + rng() % 255));
+        try
+        {
+            StoredFields damaged = read_store(corrupt);
+            for (uint32_t doc = 0; doc < damaged.size(); doc++)
+                damaged.get(doc);
+        }
+        catch (const runtime_error &)
+        {
+        }
+    }
+}
+
+TEST(IndexTest, TestTermStatistics)
+{
+    TermStatistics statistics;
+    for (string text : {"alfa bravo alfa", "bravo charlie", "alfa"})
+    {
+        RegexTokenizer regex_tokenizer = RegexTokenizer({.text = &text});
+        statistics.begin_document();
+        for (Token &token : vector<Token>(begin(regex_tokenizer), end(regex_tokenizer)))
+            statistics.add(token);
+    }
+    EXPECT_EQ(statistics.documents(), 3u);
+    EXPECT_EQ(statistics.tokens(), 6u);
+    EXPECT_EQ(statistics.unique_terms(), 3u);
+    EXPECT_EQ(statistics.doc_freq("alfa"), 2u);
+    EXPECT_EQ(statistics.total_freq("alfa"), 3u);
+    EXPECT_EQ(statistics.doc_freq("delta"), 0u);
+    EXPECT_GT(statistics.memory_usage(), 0u);
+}
+
+TEST(IndexTest, TestMemoryAccountant)
+{
+    MemoryAccountant accountant;
+    accountant.add(MemoryCategory::postings, 100);
+    accountant.add(MemoryCategory::terms, 30);
+    accountant.add(MemoryCategory::postings, -40);
+    MemorySnapshot snapshot = accountant.snapshot();
+    EXPECT_EQ(snapshot[MemoryCategory::postings], 60u);
+    EXPECT_EQ(snapshot.total(), 90u);
+    snapshot += snapshot;
+    EXPECT_EQ(snapshot.total(), 180u);
+    EXPECT_EQ(string(accountant.snapshot()),
+              "MemorySnapshot(tokens=0, terms=30, postings=60, stored_fields=0, statistics=0, segments=0, total=90)");
+}
+
+TEST(IndexTest, TestInMemoryIndexWriter)
+{
+    InMemoryIndexWriter writer(1 << 20);
+    vector<string> texts{"alfa bravo", "bravo charlie", "charlie delta alfa"};
+    for (string &text : texts)
+    {
+        RegexTokenizer regex_tokenizer = RegexTokenizer({.text = &text});
+        writer.add_document(begin(regex_tokenizer), end(regex_tokenizer), {{"original", text}});
+    }
+    EXPECT_EQ(writer.buffered_documents(), 3u);
+    EXPECT_FALSE(writer.should_flush());
+    EXPECT_GT(writer.memory().bytes(MemoryCategory::postings), 0u);
+    EXPECT_GT(writer.memory().bytes(MemoryCategory::terms), 0u);
+    EXPECT_EQ(writer.memory().bytes(MemoryCategory::segments), 0u);
+    EXPECT_GE(writer.memory().bytes(MemoryCategory::tokens), 3 * sizeof(void *));
+
+    writer.flush();
+    EXPECT_EQ(writer.buffered_documents(), 0u);
+    EXPECT_EQ(writer.memory().bytes(MemoryCategory::postings), 0u);
+    EXPECT_EQ(writer.memory().bytes(MemoryCategory::terms), 0u);
+    EXPECT_GT(writer.memory().bytes(MemoryCategory::statistics), 0u);
+
+    ASSERT_EQ(writer.flushed().size(), 1u);
+    const Segment &segment = writer.flushed()[0];
+    vector<string> expected_terms{"alfa", "bravo", "charlie", "delta"};
+    EXPECT_EQ(segment.terms.items(), expected_terms);
+    EXPECT_GT(segment.memory_usage(), segment.stored.memory_usage());
+    EXPECT_EQ(writer.memory().bytes(MemoryCategory::segments), segment.memory_usage());
+    EXPECT_EQ(segment.postings_for("alfa"), (vector<uint32_t>{0, 2}));
+    EXPECT_EQ(segment.postings_for("echo"), vector<uint32_t>{});
+    EXPECT_EQ(segment.stored.get(1), (StoredDocument{{"original", "bravo charlie"}}));
+    EXPECT_EQ(writer.term_statistics().doc_freq("charlie"), 2u);
+}
+
+TEST(IndexTest, TestInMemoryIndexWriterFlushesOnBudget)
+{
+    InMemoryIndexWriter writer(4096);
+    for (uint32_t doc = 0; doc < 200; doc++)
+    {
+        string text = format("term{} term{} common", doc, doc % 10);
+        RegexTokenizer regex_tokenizer = RegexTokenizer({.text = &text});
+        EXPECT_EQ(writer.add_document(begin(regex_tokenizer), end(regex_tokenizer)), doc);
+        EXPECT_LT(writer.buffered_bytes(), 4096u);
+    }
+    writer.flush();
+    EXPECT_GT(writer.flushed().size(), 1u);
+    uint32_t documents = 0;
+    for (const Segment &segment : writer.flushed())
+    {
+        EXPECT_EQ(segment.base_doc, documents);
+        EXPECT_EQ(segment.postings_for("common").size(), segment.doc_count);
+        documents += segment.doc_count;
+    }
+    EXPECT_EQ(documents, 200u);
+    EXPECT_EQ(writer.term_statistics().doc_freq("common"), 200u);
+}
+
+// Yields `tokens` and then throws instead of reaching the end, like a
+// tokenizer whose regex gives up partway through a document.
+struct ThrowingTokenIterator
+{
+    const vector<Token> *tokens;
+    size_t index = 0;
+
+    const Token &operator*() const
+    {
+        if (index == tokens->size())
+            throw regex_error(regex_constants::error_complexity);
+        return (*tokens)[index];
+    }
+    ThrowingTokenIterator &operator++()
+    {
+        index++;
+        return *this;
+    }
+    bool operator!=(const ThrowingTokenIterator &) const { return true; }
+};
+
+TEST(IndexTest, TestInMemoryIndexWriterRollsBackFailedDocument)
+{
+    InMemoryIndexWriter writer(1 << 20);
+    string first = "alfa bravo", second = "charlie delta";
+    RegexTokenizer first_tokenizer = RegexTokenizer({.text = &first});
+    EXPECT_EQ(writer.add_document(begin(first_tokenizer), end(first_tokenizer), {{"original", first}}), 0u);
+    size_t buffered_bytes = writer.buffered_bytes();
+
+    vector<Token> partial{Token("alfa", 0), Token("echo", 1), Token("alfa", 2)};
+    ThrowingTokenIterator failing{&partial};
+    EXPECT_THROW(writer.add_document(failing, failing, {{"original", "alfa echo alfa"}}), regex_error);
+    EXPECT_EQ(writer.buffered_documents(), 1u);
+    EXPECT_EQ(writer.term_statistics().documents(), 1u);
+    EXPECT_EQ(writer.term_statistics().doc_freq("echo"), 0u);
+    EXPECT_GE(writer.memory().bytes(MemoryCategory::tokens), 3 * sizeof(void *));
+
+    RegexTokenizer second_tokenizer = RegexTokenizer({.text = &second});
+    EXPECT_EQ(writer.add_document(begin(second_tokenizer), end(second_tokenizer), {{"original", second}}), 1u);
+    EXPECT_GT(writer.buffered_bytes(), buffered_bytes);
+
+    writer.flush();
+    const Segment &segment = writer.flushed()[0];
+    EXPECT_EQ(segment.doc_count, 2u);
+    EXPECT_EQ(segment.stored.size(), 2u);
+    EXPECT_EQ(segment.terms.items(), (vector<string>{"alfa", "bravo", "charlie", "delta"}));
+    EXPECT_EQ(segment.postings_for("alfa"), vector<uint32_t>{0});
+    EXPECT_EQ(segment.postings_for("charlie"), vector<uint32_t>{1});
+    EXPECT_EQ(segment.stored.get(1), (StoredDocument{{"original", second}}));
+    EXPECT_EQ(writer.term_statistics().total_freq("alfa"), 1u);
+}
+
+TEST(IndexTest, TestInMemoryIndexWriterSharedAccountant)
+{
+    MemoryAccountant accountant;
+    {
+        InMemoryIndexWriter first(accountant, 1 << 20);
+        InMemoryIndexWriter second(accountant, 1 << 20);
+        vector<string> texts{"alfa bravo", "bravo charlie delta"};
+        for (string &text : texts)
+        {
+            RegexTokenizer first_tokenizer = RegexTokenizer({.text = &text});
+            first.add_document(begin(first_tokenizer), end(first_tokenizer), {{"original", text}});
+            RegexTokenizer second_tokenizer = RegexTokenizer({.text = &text});
+            second.add_document(begin(second_tokenizer), end(second_tokenizer));
+        }
+        second.flush();
+
+        MemorySnapshot charges = first.charges();
+        charges += second.charges();
+        EXPECT_EQ(accountant.snapshot().bytes, charges.bytes);
+        EXPECT_EQ(&first.memory(), &accountant);
+        EXPECT_EQ(first.buffered_bytes(), first.charges()[MemoryCategory::terms] +
+                                              first.charges()[MemoryCategory::postings] +
+                                              first.charges()[MemoryCategory::stored_fields]);
+        EXPECT_EQ(second.buffered_bytes(), second.charges()[MemoryCategory::stored_fields]);
+        EXPECT_GT(accountant.bytes(MemoryCategory::postings), 0u);
+        EXPECT_GT(accountant.bytes(MemoryCategory::segments), 0u);
+    }
+    EXPECT_EQ(accountant.total(), 0u);
+}
+
+#ifdef __APPLE__
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+#endif
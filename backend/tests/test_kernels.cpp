@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "kernels/set_ops.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace kernels;
+
+static vector<uint32_t> random_list(mt19937 &rng, size_t size, uint32_t universe)
+{
+    set<uint32_t> values;
+    uniform_int_distribution<uint32_t> pick(0, universe);
+    while (values.size() < size)
+        values.insert(pick(rng));
+    return vector<uint32_t>(values.begin(), values.end());
+}
+
+static vector<Isa> supported_isas()
+{
+    vector<Isa> isas;
+    for (Isa isa : {Isa::scalar, Isa::sse41, Isa::avx2})
+        if (supports(isa))
+            isas.push_back(isa);
+    return isas;
+}
+
+// Runs every supported kernel, forcing and forbidding galloping, into an
+// exactly-sized buffer and compares with the standard library.
+static void check(const vector<uint32_t> &a, const vector<uint32_t> &b)
+{
+    vector<uint32_t> expected_intersection, expected_union, expected_difference;
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected_intersection));
+    set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected_union));
+    set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected_difference));
+
+    for (Isa isa : supported_isas())
+        for (size_t gallop_ratio : {size_t(0), size_t(1), SIZE_MAX})
+        {
+            string kernel = isa_name(isa) + " gallop_ratio=" + to_string(gallop_ratio);
+            vector<uint32_t> out(min(a.size(), b.size()));
+            out.resize(intersect(a, b, out.data(), isa, gallop_ratio));
+            EXPECT_EQ(out, expected_intersection) << kernel << " intersect " << a.size() << "x" << b.size();
+
+            out.assign(a.size() + b.size(), 0);
+            out.resize(unite(a, b, out.data(), isa, gallop_ratio));
+            EXPECT_EQ(out, expected_union) << kernel << " unite " << a.size() << "x" << b.size();
+
+            out.assign(a.size(), 0);
+            out.resize(difference(a, b, out.data(), isa, gallop_ratio));
+            EXPECT_EQ(out, expected_difference) << kernel << " difference " << a.size() << "x" << b.size();
+        }
+}
+
+TEST(KernelsTest, TestSmallLists)
+{
+    mt19937 rng(1);
+    for (size_t na = 0; na <= 20; na++)
+        for (size_t nb = 0; nb <= 20; nb++)
+            for (uint32_t universe : {40u, 200u})
+                check(random_list(rng, na, universe), random_list(rng, nb, universe));
+}
+
+TEST(KernelsTest, TestRandomLists)
+{
+    mt19937 rng(2);
+    for (int i = 0; i < 300; i++)
+    {
+        size_t na = uniform_int_distribution<size_t>(0, 500)(rng);
+        size_t nb = uniform_int_distribution<size_t>(0, 500)(rng);
+        uint32_t universe = uniform_int_distribution<uint32_t>(1000, 5000)(rng);
+        check(random_list(rng, na, universe), random_list(rng, nb, universe));
+    }
+}
+
+TEST(KernelsTest, TestSkewedLists)
+{
+    mt19937 rng(3);
+    for (size_t ratio : {16, 31, 32, 33, 63, 64, 100, 127, 128, 1000})
+        for (size_t small : {1, 3, 9, 17})
+        {
+            vector<uint32_t> large = random_list(rng, small * ratio, static_cast<uint32_t>(small * ratio * 3));
+            vector<uint32_t> few = random_list(rng, small, static_cast<uint32_t>(small * ratio * 3));
+            check(large, few);
+            check(few, large);
+        }
+}
+
+TEST(KernelsTest, TestIdenticalAndDisjointLists)
+{
+    vector<uint32_t> even, odd;
+    for (uint32_t i = 0; i < 1000; i++)
+        (i % 2 ? odd : even).push_back(i);
+    check(even, even);
+    check(even, odd);
+    check(odd, even);
+}
+
+TEST(KernelsTest, TestExtremeValues)
+{
+    vector<uint32_t> a{0, 1, 2, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff};
+    vector<uint32_t> b{0, 2, 3, 0x7ffffffe, 0x80000000, 0xc0000000, 0xfffffffd, 0xffffffff};
+    check(a, b);
+    check(b, a);
+}
+
+TEST(KernelsTest, TestVectorOverloads)
+{
+    vector<uint32_t> a{1, 3, 5, 7, 9}, b{3, 4, 5, 6};
+    EXPECT_EQ(intersect(a, b), (vector<uint32_t>{3, 5}));
+    EXPECT_EQ(unite(a, b), (vector<uint32_t>{1, 3, 4, 5, 6, 7, 9}));
+    EXPECT_EQ(difference(a, b), (vector<uint32_t>{1, 7, 9}));
+    EXPECT_TRUE(supports(Isa::scalar));
+}
+
+#ifdef __APPLE__
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+#endif
@@ -0,0 +1,189 @@
+#include "gtest/gtest.h"
+#include "tokenizer_harness.hpp"
+#include <optional>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace analysis;
+using namespace harness;
+
+static const vector<string> corpus = {
+    "",
+    " ",
+    "alfa",
+    "alfa bravo charlie delta",
+    "AAAaaaBBBbbbCCCcccDDDddd",
+    "www.example.com is a.b..c. and .d.",
+    "trailing.",
+    "..leading",
+    "wild*card *prefix suffix* ***",
+    "snake_case 42 3.14 v1.2.3",
+    "tabs\tand\nnewlines\r\n",
+    "caf\xc3\xa9 na\xc3\xafve",
+    "/alfa/bravo/charlie/delta/",
+    "alfa//bravo/",
+    "relative/path",
+    "alfa  bravo   charlie",
+};
+
+// Every combination of the output flags over the default pattern, the only
+// one an engine supports so far.
+static vector<TokenizerConfig> corpus_configs(string *text)
+{
+    vector<TokenizerConfig> configs;
+    for (int flags = 0; flags < 32; flags++)
+        configs.push_back({.text = text, .positions = (flags & 1) != 0, .chars = (flags & 2) != 0,
+                           .keep_original = (flags & 4) != 0, .remove_stops = (flags & 8) != 0,
+                           .start_char = flags & 16 ? 7 : 0});
+    return configs;
+}
+
+TEST(TokenizerDifferentialTest, TestCorpusRegexEngines)
+{
+    for (string text : corpus)
+        for (const TokenizerConfig &config : corpus_configs(&text))
+        {
+            EngineCheck check = check_engines(config, reference_regex, regex_engines());
+            EXPECT_GT(check.engines, 0u) << describe(config);
+            EXPECT_FALSE(check.mismatch.has_value()) << check.mismatch.value_or("");
+        }
+}
+
+TEST(TokenizerDifferentialTest, TestRandomizedEngines)
+{
+    mt19937 rng(20241019);
+    int compared = 0;
+    for (int i = 0; i < 2000; i++)
+    {
+        string text = random_text(rng, 48);
+        TokenizerConfig config = random_config(rng, &text);
+        EngineCheck check = check_engines(config, reference_regex, regex_engines());
+        ASSERT_FALSE(check.mismatch.has_value()) << check.mismatch.value();
+        compared += check.engines > 0;
+    }
+    EXPECT_GT(compared, 1600);
+}
+
+TEST(TokenizerDifferentialTest, TestWordScannerMatchesDefaultPattern)
+{
+    mt19937 rng(7);
+    for (int i = 0; i < 2000; i++)
+    {
+        string text = random_text(rng, 64);
+        TokenizerConfig config{.text = &text, .positions = (i & 1) != 0, .chars = (i & 2) != 0,
+                               .keep_original = (i & 4) != 0, .start_char = i % 5};
+        optional<string> mismatch = compare(reference_regex(config), scan_words(config));
+        ASSERT_FALSE(mismatch.has_value()) << describe(config) << ": " << mismatch.value();
+    }
+    string text = "alfa";
+    EXPECT_THROW(scan_words({.text = &text, .gaps = true}), invalid_argument);
+}
+
+// Properties of the reference itself, so that an engine matching it is known
+// to match sensible output rather than a broken baseline.
+TEST(TokenizerDifferentialTest, TestRegexTokenizerProperties)
+{
+    mt19937 rng(99);
+    for (int i = 0; i < 1000; i++)
+    {
+        string text = random_text(rng, 48);
+        TokenizerConfig config{.text = &text, .positions = true, .chars = true, .start_char = i % 3};
+        vector<Token> tokens = reference_regex(config);
+        int previous_end = config.start_char;
+        for (size_t j = 0; j < tokens.size(); j++)
+        {
+            const Token &token = tokens[j];
+            ASSERT_FALSE(token.text.empty());
+            EXPECT_EQ(token.pos, static_cast<int>(j));
+            EXPECT_GE(token.start_char, previous_end);
+            EXPECT_EQ(text.substr(token.start_char - config.start_char, token.end_char - token.start_char), token.text);
+            previous_end = token.end_char;
+        }
+    }
+}
+
+// PathTokenizer has no optimized engine yet; pin down its semantics so one can
+// be checked against it later. There is one token per path segment and every
+// token extends the previous one. Token text is only exact for paths with a
+// single leading '/', where token j is the path up to the end of segment j.
+TEST(TokenizerDifferentialTest, TestPathTokenizerProperties)
+{
+    mt19937 rng(11);
+    for (int i = 0; i < 1000; i++)
+    {
+        string text = random_text(rng, 48);
+        TokenizerConfig config{.text = &text, .positions = true};
+        vector<Token> tokens = reference_path(config);
+
+        regex segment("[^/]+");
+        vector<size_t> segment_ends;
+        for (sregex_iterator it(text.begin(), text.end(), segment), last; it != last; ++it)
+            segment_ends.push_back(static_cast<size_t>(it->position() + it->length()));
+        ASSERT_EQ(tokens.size(), segment_ends.size()) << describe(config);
+
+        for (size_t j = 0; j < tokens.size(); j++)
+        {
+            EXPECT_EQ(tokens[j].pos, static_cast<int>(j));
+            if (j > 0)
+            {
+                EXPECT_TRUE(tokens[j].text.starts_with(tokens[j - 1].text)) << describe(config);
+            }
+        }
+
+        string path = "/";
+        vector<string> segments;
+        for (size_t n = uniform_int_distribution<size_t>(1, 6)(rng); segments.size() < n;)
+        {
+            string name = random_text(rng, 8);
+            erase(name, '/');
+            if (!name.empty())
+                segments.push_back(name);
+        }
+        vector<string> expected;
+        for (const string &name : segments)
+        {
+            path += expected.empty() ? name : "/" + name;
+            expected.push_back(path.substr(1));
+        }
+        if (i % 2)
+            path += "/";
+        tokens = reference_path({.text = &path});
+        vector<string> texts;
+        for (const Token &token : tokens)
+            texts.push_back(token.text);
+        EXPECT_EQ(texts, expected) << path;
+    }
+}
+
+// Copying a tokenizer mid-stream must resume from the same token.
+TEST(TokenizerDifferentialTest, TestCopyResumesStream)
+{
+    mt19937 rng(5);
+    for (int i = 0; i < 200; i++)
+    {
+        string text = random_text(rng, 48);
+        TokenizerConfig config{.text = &text, .positions = true, .chars = true};
+        vector<Token> tokens = reference_regex(config);
+        size_t skip = tokens.empty() ? 0 : i % tokens.size();
+
+        RegexTokenizer tokenizer = RegexTokenizer(config);
+        for (size_t j = 0; j < skip; j++)
+            ++tokenizer;
+        RegexTokenizer copy = RegexTokenizer(tokenizer);
+        vector<Token> resumed = vector<Token>(begin(copy), end(copy));
+        vector<Token> expected_tokens = vector<Token>(tokens.begin() + skip, tokens.end());
+        optional<string> mismatch = compare(expected_tokens, resumed);
+        ASSERT_FALSE(mismatch.has_value()) << describe(config) << ": " << mismatch.value();
+    }
+}
+
+#ifdef __APPLE__
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+#endif
@@ -1,11 +1,38 @@
 #include "gtest/gtest.h"
 #include "utils/utils.hpp"
+#include "utils/compression.hpp"
+#include <random>
+#include <stdexcept>
+#include <string>
 
 TEST(UtilsTest, DummyTest) {
     // This is just a dummy test
     EXPECT_EQ(1, 1);
 }
 
+TEST(UtilsTest, CompressionRoundTrip) {
+    std::string repetitive;
+    for (int i = 0; i < 1000; i++)
+        repetitive += "alfa bravo charlie delta " + std::to_string(i % 7) + "\n";
+    std::mt19937 rng(42);
+    std::string noise(5000, '\0');
+    for (char &c : noise)
+        c = static_cast<char>(rng());
+
+    for (const std::string &input : {std::string(), std::string("abc"), std::string(300, 'x'), repetitive, noise}) {
+        std::string compressed = utils::compress(input);
+        EXPECT_EQ(utils::decompress(compressed, input.size()), input);
+    }
+    EXPECT_LT(utils::compress(repetitive).size(), repetitive.size() / 10);
+}
+
+TEST(UtilsTest, CompressionRejectsCorruptInput) {
+    std::string compressed = utils::compress(std::string(300, 'x'));
+    EXPECT_THROW(utils::decompress(compressed, 299), std::runtime_error);
+    EXPECT_THROW(utils::decompress(compressed.substr(0, 3), 300), std::runtime_error);
+    EXPECT_THROW(utils::decompress(std::string("\x0f\x01\x00", 3), 19), std::runtime_error);
+}
+
 #ifdef __APPLE__
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,142 @@
+#ifndef TOKENIZER_HARNESS_HPP
+#define TOKENIZER_HARNESS_HPP
+#pragma once
+#include "analysis/tokenizers.hpp"
+#include <format>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Differential harness shared by the tokenizer tests and the libFuzzer
+// target. RegexTokenizer is the reference semantics; every optimized engine
+// registered below must reproduce its output field by field, quirks included,
+// for every config it claims to support.
+namespace harness
+{
+  using namespace std;
+  using namespace analysis;
+
+  struct TokenizerEngine
+  {
+    string name;
+    function<bool(const TokenizerConfig &)> supports;
+    function<vector<Token>(const TokenizerConfig &)> run;
+  };
+
+  template <typename Tokenizer>
+  vector<Token> collect(const TokenizerConfig &config)
+  {
+    Tokenizer tokenizer = Tokenizer(config);
+    return vector<Token>(begin(tokenizer), end(tokenizer));
+  }
+
+  inline vector<Token> reference_regex(const TokenizerConfig &config) { return collect<RegexTokenizer>(config); }
+  inline vector<Token> reference_path(const TokenizerConfig &config) { return collect<PathTokenizer>(config); }
+
+  // Engines that must match RegexTokenizer.
+  inline vector<TokenizerEngine> regex_engines()
+  {
+    return {
+        {"scan_words", supports_word_scanner, scan_words},
+    };
+  }
+
+  inline string describe(const Token &token)
+  {
+    return format("Token(text=\"{}\", pos={}, start_char={}, end_char={}, original=\"{}\", boost={}, "
+                  "stopped={}, chars={}, positions={}, remove_stops={}, mode=\"{}\")",
+                  token.text, token.pos, token.start_char, token.end_char, token.original, token.boost,
+                  token.stopped, token.chars, token.positions, token.remove_stops, token.mode);
+  }
+
+  inline string describe(const TokenizerConfig &config)
+  {
+    return format("TokenizerConfig(text=\"{}\", pattern=\"{}\", tokenize={}, gaps={}, positions={}, chars={}, "
+                  "keep_original={}, start_char={})",
+                  config.text ? *config.text : string("null"), config.pattern, config.tokenize, config.gaps,
+                  config.positions, config.chars, config.keep_original, config.start_char);
+  }
+
+  // Token::operator== only looks at text, pos and original; engines have to
+  // agree on every field a consumer can observe.
+  inline optional<string> compare(const vector<Token> &expected, const vector<Token> &actual)
+  {
+    for (size_t i = 0; i < max(expected.size(), actual.size()); i++)
+    {
+      string expected_str = i < expected.size() ? describe(expected[i]) : string("<missing>");
+      string actual_str = i < actual.size() ? describe(actual[i]) : string("<missing>");
+      if (expected_str != actual_str)
+        return format("token {}: expected {}, got {}", i, expected_str, actual_str);
+    }
+    return nullopt;
+  }
+
+  struct EngineCheck
+  {
+    size_t engines = 0; // engines that supported the config and were compared
+    optional<string> mismatch;
+  };
+
+  // Runs every engine supporting `config` against `reference` and describes the
+  // first divergence. A config no engine supports compares nothing, so callers
+  // should make sure `engines` is non-zero for the configs they care about.
+  inline EngineCheck check_engines(const TokenizerConfig &config,
+                                   const function<vector<Token>(const TokenizerConfig &)> &reference,
+                                   const vector<TokenizerEngine> &engines)
+  {
+    EngineCheck check;
+    vector<Token> expected = reference(config);
+    for (const TokenizerEngine &engine : engines)
+    {
+      if (!engine.supports(config))
+        continue;
+      check.engines++;
+      if (optional<string> mismatch = compare(expected, engine.run(config)))
+      {
+        check.mismatch = format("{} diverges on {}: {}", engine.name, describe(config), mismatch.value());
+        break;
+      }
+    }
+    return check;
+  }
+
+  // Bytes chosen to exercise word boundaries, dotted words, wildcards, path
+  // separators, whitespace runs and non-ASCII input.
+  inline string random_text(mt19937 &rng, size_t max_length)
+  {
+    static const string alphabet = "abcXYZ019_*..//  \t\n-,\xc3\xa9";
+    uniform_int_distribution<size_t> length(0, max_length);
+    uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    string text(length(rng), ' ');
+    for (char &c : text)
+      c = alphabet[pick(rng)];
+    return text;
+  }
+
+  // Nine in ten configs use the default pattern, which scan_words supports, so
+  // most runs compare something. The rest vary pattern, gaps and tokenize and
+  // only run the reference.
+  inline TokenizerConfig random_config(mt19937 &rng, string *text)
+  {
+    static const vector<string> patterns = {TokenizerConfig().pattern, "[A-Z]+", "\\s+", "[^/]+", "\\."};
+    bernoulli_distribution flip(0.5);
+    bernoulli_distribution rare(0.1);
+    TokenizerConfig config;
+    config.text = text;
+    if (rare(rng))
+    {
+      config.pattern = patterns[uniform_int_distribution<size_t>(0, patterns.size() - 1)(rng)];
+      config.tokenize = flip(rng);
+      config.gaps = flip(rng);
+    }
+    config.positions = flip(rng);
+    config.chars = flip(rng);
+    config.keep_original = flip(rng);
+    config.remove_stops = flip(rng);
+    config.start_char = flip(rng) ? 0 : uniform_int_distribution<int>(1, 100)(rng);
+    return config;
+  }
+}
+#endif